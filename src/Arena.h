@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <utility>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+
+/*
+* Monotonic bump allocator.
+* Memory is carved out of large blocks and only given back all at once by
+* reset() or the destructor, which also run the destructors of the objects
+* built with create(), in reverse order.
+* An Arena is not thread safe.
+*/
+class Arena
+{
+public:
+    /**
+     * Constructor
+     * @param blockSize size of the blocks requested to the heap, bigger
+     * allocations get a block of their own
+     */
+    explicit Arena(const size_t blockSize = 4096) : blockSize_(blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() { destroyAll(); }
+
+    void* allocate(const size_t size, const size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t p = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (cursor_ == 0 || p + size > end_) {
+            grow(size + alignment);
+            p = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        }
+        cursor_ = p + size;
+        used_ += size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    // Construct an object in the arena. Its destructor runs at reset().
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            destructors_.push_back(Destructor{ object, &destroy<T> });
+        return object;
+    }
+
+    // Release everything, keeping the first block around for reuse.
+    void reset() {
+        destroyAll();
+        if (blocks_.size() > 1) blocks_.resize(1);
+        if (blocks_.empty()) {
+            cursor_ = end_ = 0;
+        }
+        else {
+            cursor_ = reinterpret_cast<uintptr_t>(blocks_[0].data.get());
+            end_ = cursor_ + blocks_[0].size;
+        }
+        used_ = 0;
+    }
+
+    // Bytes handed out since the last reset().
+    size_t used() const { return used_; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    template <typename T>
+    static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+    void grow(const size_t minSize) {
+        const size_t size = minSize > blockSize_ ? minSize : blockSize_;
+        blocks_.push_back(Block{ std::unique_ptr<char[]>(new char[size]), size });
+        cursor_ = reinterpret_cast<uintptr_t>(blocks_.back().data.get());
+        end_ = cursor_ + size;
+    }
+
+    void destroyAll() {
+        for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it)
+            it->destroy(it->object);
+        destructors_.clear();
+    }
+
+    const size_t blockSize_;
+    std::vector<Block> blocks_;
+    std::vector<Destructor> destructors_;
+    uintptr_t cursor_ = 0;
+    uintptr_t end_ = 0;
+    size_t used_ = 0;
+};
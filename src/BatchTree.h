@@ -0,0 +1,330 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include "BehaviourTree.h"
+#include "Simd.h"
+#include "Arena.h"
+#include "SmallVector.h"
+
+
+/*
+* Trees ticked for a whole batch of agents at once, e.g. a crowd evaluating
+* the same guards every frame.
+* The agents' data is laid out in columns, one array per variable indexed by
+* agent, and the statuses of the agents are bitmasks, one bit per agent: the
+* nodes test 64 agents per word instead of being called once per agent.
+*/
+class BatchTree {
+public:
+	typedef BehaviourTree::Status Status;
+	typedef uint64_t Word;
+
+	// Number of words holding one bit per agent.
+	static size_t words(const size_t agents) { return (agents + 63) / 64; }
+	static bool test(const Word* mask, const size_t agent) { return (mask[agent / 64] >> (agent % 64)) & 1; }
+
+	// The statuses of the agents of a batch, as parallel bitmasks: agent i is bit i % 64
+	// of word i / 64. An agent has at most one of its bits set, none if it was not run.
+	struct Statuses {
+		Word* success;
+		Word* failure;
+		Word* running;
+		Word* error;
+		size_t words;
+
+		Status get(const size_t agent) const {
+			if (test(success, agent)) return Status::SUCCESS;
+			if (test(failure, agent)) return Status::FAILURE;
+			if (test(running, agent)) return Status::RUNNING;
+			if (test(error, agent)) return Status::ERROR;
+			return Status::NOTRUN;
+		}
+	};
+
+	// Everything a node may need while ticking a batch, passed down to run().
+	struct TickContext {
+		size_t agents = 0;		// the agents of the batch, 0 to agents - 1
+		uint64_t tickId = 0;	// incremented at each tick
+		Arena scratch;			// the masks of the tick, released at the next tick
+
+		size_t words() const { return BatchTree::words(agents); }
+		// A cleared mask, valid until the next tick.
+		Word* mask() {
+			Word* m = static_cast<Word*>(scratch.allocate(words() * sizeof(Word), alignof(Word)));
+			std::memset(m, 0, words() * sizeof(Word));
+			return m;
+		}
+		Statuses statuses() {
+			Word* m = static_cast<Word*>(scratch.allocate(4 * words() * sizeof(Word), alignof(Word)));
+			std::memset(m, 0, 4 * words() * sizeof(Word));
+			return Statuses{ m, m + words(), m + 2 * words(), m + 3 * words(), words() };
+		}
+	};
+
+	// A node run for all the agents of a batch at once.
+	class Node {
+	public:
+		virtual ~Node() = default;
+		// Set the statuses of the agents whose bit is set in active, in out, cleared beforehand.
+		// The other agents are left alone.
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) = 0;
+	};
+
+	// The composites and decorators are pure functions of their children's statuses,
+	// applied to 64 agents per word. They keep no memory from one tick to the next:
+	// a RUNNING child is run again from the start of its composite, like in a reactive
+	// sequence, since remembering it per agent would break the batch apart.
+	class CompositeNode : public Node {
+	public:
+		typedef SmallVector<Node*, BT_INLINE_CHILDREN> Children;
+
+		const Children& getChildren() const { return _children; }
+		void addChild(Node* child) { _children.push_back(child); }
+		void addChildren(std::initializer_list<Node*>&& newChildren) {
+			for (Node* child : newChildren) addChild(child);
+		}
+	protected:
+		// Run the children in turn, each for the agents the previous ones passed on:
+		// those whose status is carry go on to the next child, the others are settled.
+		// The agents still carried after the last child get the status carry.
+		void runChildren(TickContext& ctx, const Word* active, Statuses& out, const Status carry) {
+			const size_t words = out.words;
+			Word* left = ctx.mask();
+			std::memcpy(left, active, words * sizeof(Word));
+			Statuses child = ctx.statuses();
+			Word* carried = carry == Status::SUCCESS ? child.success : child.failure;
+			Word* settled = carry == Status::SUCCESS ? child.failure : child.success;
+			Word* opposite = carry == Status::SUCCESS ? out.failure : out.success;
+			for (Node* c : _children) {
+				if (none(left, words)) return;
+				std::memset(child.success, 0, 4 * words * sizeof(Word));	// the masks are contiguous
+				c->run(ctx, left, child);
+				for (size_t w = 0; w < words; w++) {
+					opposite[w] |= settled[w];
+					out.running[w] |= child.running[w];
+					out.error[w] |= child.error[w];
+					left[w] = carried[w];
+				}
+			}
+			Word* last = carry == Status::SUCCESS ? out.success : out.failure;
+			for (size_t w = 0; w < words; w++) last[w] |= left[w];
+		}
+	private:
+		Children _children;
+	};
+
+	// SUCCESS for the agents for which every child succeeds. The next child only
+	// runs for the agents the previous ones succeeded for.
+	class Sequence : public CompositeNode {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			runChildren(ctx, active, out, Status::SUCCESS);
+		}
+	};
+
+	// FAILURE for the agents for which every child fails. The next child only
+	// runs for the agents the previous ones failed for.
+	class Select : public CompositeNode {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			runChildren(ctx, active, out, Status::FAILURE);
+		}
+	};
+
+	class DecoratorNode : public Node {
+	public:
+		void setChild(Node* child) { _child = child; }
+		Node* getChild() const { return _child; }
+	private:
+		Node* _child = nullptr;
+	};
+
+	// Swap SUCCESS and FAILURE.
+	class Invert : public DecoratorNode {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			getChild()->run(ctx, active, out);
+			for (size_t w = 0; w < out.words; w++) std::swap(out.success[w], out.failure[w]);
+		}
+	};
+
+	// SUCCESS whether the child succeeds or fails; RUNNING and ERROR pass through.
+	class Succeed : public DecoratorNode {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			getChild()->run(ctx, active, out);
+			for (size_t w = 0; w < out.words; w++) {
+				out.success[w] |= out.failure[w];
+				out.failure[w] = 0;
+			}
+		}
+	};
+
+	// FAILURE whether the child succeeds or fails; RUNNING and ERROR pass through.
+	class Fail : public DecoratorNode {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			getChild()->run(ctx, active, out);
+			for (size_t w = 0; w < out.words; w++) {
+				out.failure[w] |= out.success[w];
+				out.success[w] = 0;
+			}
+		}
+	};
+
+	// A leaf testing a predicate for every agent, SUCCESS where it holds and FAILURE elsewhere.
+	class Condition : public Node {
+	public:
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			Word* pass = ctx.mask();
+			if (!test(ctx, active, pass)) {
+				for (size_t w = 0; w < out.words; w++) out.error[w] = active[w];
+				return;
+			}
+			for (size_t w = 0; w < out.words; w++) {
+				out.success[w] = active[w] & pass[w];
+				out.failure[w] = active[w] & ~pass[w];
+			}
+		}
+		// Set the bits of pass of the agents for which the predicate holds.
+		// Only the active agents matter, words without any may be skipped.
+		// @return false if the agents' data could not be read, making them ERROR
+		virtual bool test(TickContext& ctx, const Word* active, Word* pass) = 0;
+	};
+
+	// SUCCESS for the agents whose value in a column compares with an operand,
+	// vectorized over the column. ERROR if the column is shorter than the batch.
+	class Compare : public Condition {
+	public:
+		Compare(const std::vector<float>& column, const Simd::Compare op, const float operand) :
+			_column(column), _op(op), _operand(operand) {}
+		virtual bool test(TickContext& ctx, const Word* active, Word* pass) override {
+			if (_column.size() < ctx.agents)
+				return false;
+			for (size_t w = 0; w < ctx.words(); w++) {
+				if (active[w] == 0) continue;
+				const size_t first = w * 64;
+				Simd::compare(_column.data() + first, std::min<size_t>(64, ctx.agents - first), _op, _operand, &pass[w]);
+			}
+			return true;
+		}
+	private:
+		const std::vector<float>& _column;
+		const Simd::Compare _op;
+		const float _operand;
+	};
+
+	// SUCCESS for the agents whose pointer in a column is nullptr,
+	// like BehaviourTree::IsNull. ERROR if the column is shorter than the batch.
+	template <typename T>
+	class IsNull : public Condition {
+	public:
+		explicit IsNull(const std::vector<T*>& column) : _column(column) {}
+		virtual bool test(TickContext& ctx, const Word* active, Word* pass) override {
+			if (_column.size() < ctx.agents)
+				return false;
+			for (size_t w = 0; w < ctx.words(); w++) {
+				if (active[w] == 0) continue;
+				const size_t first = w * 64, n = std::min<size_t>(64, ctx.agents - first);
+				Word bits = 0;
+				for (size_t i = 0; i < n; i++)
+					bits |= Word(_column[first + i] == nullptr) << i;
+				pass[w] = bits;
+			}
+			return true;
+		}
+	private:
+		const std::vector<T*>& _column;
+	};
+
+	// A predicate called for each active agent: the fallback for the guards
+	// that can't be expressed over columns.
+	class Predicate : public Condition {
+	public:
+		explicit Predicate(std::function<bool(size_t agent)> predicate) : _predicate(std::move(predicate)) {}
+		virtual bool test(TickContext& ctx, const Word* active, Word* pass) override {
+			for (size_t w = 0; w < ctx.words(); w++) {
+				for (Word bits = active[w]; bits != 0; bits &= bits - 1) {
+					const size_t i = lowest(bits);
+					if (_predicate(w * 64 + i)) pass[w] |= Word(1) << i;
+				}
+			}
+			return true;
+		}
+	private:
+		std::function<bool(size_t)> _predicate;
+	};
+
+	// A leaf calling a function for each active agent, which returns the agent's Status:
+	// the way to actions, and to anything that may be RUNNING.
+	class Action : public Node {
+	public:
+		explicit Action(std::function<Status(size_t agent)> action) : _action(std::move(action)) {}
+		virtual void run(TickContext& ctx, const Word* active, Statuses& out) override {
+			for (size_t w = 0; w < out.words; w++) {
+				for (Word bits = active[w]; bits != 0; bits &= bits - 1) {
+					const size_t i = lowest(bits);
+					const Word bit = Word(1) << i;
+					switch (_action(w * 64 + i)) {
+					case Status::SUCCESS: out.success[w] |= bit; break;
+					case Status::FAILURE: out.failure[w] |= bit; break;
+					case Status::RUNNING: out.running[w] |= bit; break;
+					case Status::ERROR: out.error[w] |= bit; break;
+					default: break;
+					}
+				}
+			}
+		}
+	private:
+		std::function<Status(size_t)> _action;
+	};
+
+	static bool none(const Word* mask, const size_t words) {
+		for (size_t w = 0; w < words; w++)
+			if (mask[w] != 0) return false;
+		return true;
+	}
+
+	// The index of the lowest bit set.
+	static size_t lowest(const Word bits) {
+#if defined(__GNUC__)
+		return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+		size_t i = 0;
+		while (!((bits >> i) & 1)) ++i;
+		return i;
+#endif
+	}
+
+public:
+	explicit BatchTree(Node* root = nullptr) : _root(root) {}
+	BatchTree(const BatchTree&) = delete;
+	BatchTree& operator=(const BatchTree&) = delete;
+
+	void setRoot(Node* root) { _root = root; }
+
+	// Run a single pass through the tree for agents 0 to agents - 1.
+	// The statuses are valid until the next tick.
+	const Statuses& tick(const size_t agents) {
+		_context.agents = agents;
+		++_context.tickId;
+		_context.scratch.reset();
+		Word* active = _context.mask();
+		for (size_t i = 0; i < agents / 64; i++) active[i] = ~Word(0);
+		if (agents % 64 != 0) active[agents / 64] = (Word(1) << (agents % 64)) - 1;
+		_statuses = _context.statuses();
+		if (_root != nullptr) _root->run(_context, active, _statuses);
+		return _statuses;
+	}
+	TickContext& getContext() { return _context; }
+
+private:
+	Node* _root;
+	TickContext _context;
+	Statuses _statuses = Statuses();
+};
@@ -0,0 +1,134 @@
+//
+// Trees ticked for batches of agents, over columns and bitmasks.
+//
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "BatchTree.h"
+#include "Random.h"
+
+typedef BatchTree BBT;
+typedef BehaviourTree::Status Status;
+
+void testCompare() {
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const Simd::Compare ops[] = { Simd::Compare::LESS, Simd::Compare::LESS_EQUAL, Simd::Compare::GREATER,
+								  Simd::Compare::GREATER_EQUAL, Simd::Compare::EQUAL, Simd::Compare::NOT_EQUAL };
+	Random rng(3);
+	for (size_t n = 0; n < 200; n++) {
+		std::vector<float> values(n);
+		for (float& v : values) v = rng.below(8) == 0 ? nan : static_cast<float>(rng.below(10));
+		for (const Simd::Compare op : ops) {
+			std::vector<uint64_t> mask(BBT::words(n), ~uint64_t(0));
+			Simd::compare(values.data(), n, op, 5.0f, mask.data());
+			for (size_t i = 0; i < mask.size() * 64; i++)
+				assert(BBT::test(mask.data(), i) == (i < n && Simd::holds(values[i], op, 5.0f)));
+		}
+	}
+}
+
+void testConditions() {
+	const size_t agents = 1000;
+	std::vector<float> health(agents);
+	std::vector<int*> target(agents, nullptr);
+	int enemy = 0;
+	for (size_t i = 0; i < agents; i++) {
+		health[i] = static_cast<float>(i % 100);
+		if (i % 3 == 0) target[i] = &enemy;
+	}
+
+	BBT::Compare wounded(health, Simd::Compare::LESS, 30.0f);
+	BBT tree(&wounded);
+	const BBT::Statuses& s = tree.tick(agents);
+	for (size_t i = 0; i < agents; i++)
+		assert(s.get(i) == (health[i] < 30.0f ? Status::SUCCESS : Status::FAILURE));
+	// No bit past the batch.
+	assert(!BBT::test(s.success, agents) && !BBT::test(s.failure, agents));
+
+	BBT::IsNull<int> idle(target);
+	tree.setRoot(&idle);
+	tree.tick(agents);
+	for (size_t i = 0; i < agents; i++)
+		assert(s.get(i) == (i % 3 == 0 ? Status::FAILURE : Status::SUCCESS));
+
+	BBT::Predicate odd([](size_t agent) { return agent % 2 == 1; });
+	tree.setRoot(&odd);
+	const BBT::Statuses& p = tree.tick(agents);
+	for (size_t i = 0; i < agents; i++)
+		assert(p.get(i) == (i % 2 ? Status::SUCCESS : Status::FAILURE));
+
+	// A column that doesn't cover the batch.
+	tree.setRoot(&wounded);
+	const BBT::Statuses& e = tree.tick(agents + 1);
+	assert(e.get(0) == Status::ERROR && e.get(agents) == Status::ERROR);
+}
+
+// Composites only descend into the agents still undecided.
+void testComposites() {
+	const size_t agents = 777;
+	Random rng(11);
+	std::vector<float> health(agents);
+	std::vector<int*> target(agents, nullptr);
+	int enemy = 0;
+	for (size_t i = 0; i < agents; i++) {
+		health[i] = static_cast<float>(rng.below(100));
+		if (rng.below(2)) target[i] = &enemy;
+	}
+	const auto act = [](size_t agent) {
+		const Status results[] = { Status::SUCCESS, Status::FAILURE, Status::RUNNING, Status::ERROR };
+		return results[agent % 4];
+	};
+	size_t acted = 0, tested = 0;
+
+	BBT::Compare wounded(health, Simd::Compare::LESS, 30.0f), healthy(health, Simd::Compare::GREATER_EQUAL, 90.0f);
+	BBT::IsNull<int> idle(target);
+	BBT::Invert hasTarget, notHealthy;
+	hasTarget.setChild(&idle);
+	notHealthy.setChild(&healthy);
+	BBT::Action attack([&](size_t agent) { ++acted; return act(agent); });
+	BBT::Predicate odd([&](size_t agent) { ++tested; return agent % 2 == 1; });
+	BBT::Fail never;
+	never.setChild(&odd);
+	BBT::Sequence fight;
+	fight.addChildren({ &wounded, &hasTarget, &attack });
+	BBT::Select select;
+	select.addChildren({ &fight, &never, &notHealthy });
+	BBT tree(&select);
+
+	const BBT::Statuses& s = tree.tick(agents);
+	size_t expectedActed = 0, expectedTested = 0;
+	for (size_t i = 0; i < agents; i++) {
+		Status expected = Status::FAILURE;
+		if (health[i] < 30.0f && target[i] != nullptr) {
+			++expectedActed;
+			expected = act(i);
+		}
+		if (expected == Status::FAILURE) {
+			++expectedTested;
+			expected = health[i] < 90.0f ? Status::SUCCESS : Status::FAILURE;
+		}
+		assert(s.get(i) == expected);
+	}
+	assert(acted == expectedActed && tested == expectedTested);
+
+	// Succeed keeps RUNNING and ERROR.
+	BBT::Succeed succeed;
+	succeed.setChild(&attack);
+	tree.setRoot(&succeed);
+	tree.tick(agents);
+	for (size_t i = 0; i < agents; i++) {
+		const Status a = act(i);
+		assert(s.get(i) == (a == Status::FAILURE ? Status::SUCCESS : a));
+	}
+}
+
+int main()
+{
+	testCompare();
+	testConditions();
+	testComposites();
+	std::cout << "BatchTree tests passed." << std::endl;
+}
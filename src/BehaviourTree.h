@@ -6,12 +6,29 @@
 #include <stack>
 #include <initializer_list>
 #include <string>
+#include <unordered_map>
+#include <cstdint>
 #include <cstdlib>
 #include <chrono>
 #include <algorithm>
 #include <sstream>
 #include <future>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <limits>
 #include "ConcurrentStack.h"
+#include "TimerWheel.h"
+#include "Blackboard.h"
+#include "Arena.h"
+#include "Random.h"
+#include "SmallVector.h"
+#include "Simd.h"
+
+// Number of children a composite node stores inline, before allocating.
+#ifndef BT_INLINE_CHILDREN
+#define BT_INLINE_CHILDREN 4
+#endif
 
 /// A C++11 Implementation of the Behavior Tree design pattern
 /// 
@@ -23,7 +40,7 @@ class BehaviourTree {
 
 
 public:
-	enum class Status {
+	enum class Status : int8_t {
 		ERROR = -1,
 		FAILURE = 0,
 		SUCCESS = 1,
@@ -31,33 +48,176 @@ public:
 		NOTRUN = 3
 	};
 
+	static const char* statusName(const Status s) {
+		switch (s) {
+		case Status::ERROR: return "ERROR";
+		case Status::FAILURE: return "FAILURE";
+		case Status::SUCCESS: return "SUCCESS";
+		case Status::RUNNING: return "RUNNING";
+		default: return "NOTRUN";
+		}
+	}
+
+	class Node;
+	struct TickContext;
+
+	// Receives the nodes entering and leaving run(), when set in the TickContext.
+	class Tracer {
+	public:
+		virtual ~Tracer() = default;
+		virtual void enter(const Node& node, const TickContext& ctx) = 0;
+		virtual void exit(const Node& node, const TickContext& ctx, Status status) = 0;
+	};
+
+	// Forwards the nodes entering and leaving run() to several tracers.
+	class Tracers : public Tracer {
+	public:
+		Tracers(std::initializer_list<Tracer*> tracers) : _tracers(tracers) {}
+		void add(Tracer* tracer) { _tracers.push_back(tracer); }
+		void enter(const Node& node, const TickContext& ctx) override {
+			for (Tracer* t : _tracers) t->enter(node, ctx);
+		}
+		void exit(const Node& node, const TickContext& ctx, Status status) override {
+			for (Tracer* t : _tracers) t->exit(node, ctx, status);
+		}
+	private:
+		std::vector<Tracer*> _tracers;
+	};
+
+	// Everything a node may need during a pass through the tree, passed down to run().
+	// Per agent data lives here rather than in the nodes, so that one tree can be
+	// ticked for many agents, each with its own context.
+	// Time based nodes read the clock sampled once per tick from here instead of
+	// querying it themselves.
+	struct TickContext {
+		TickContext(TimerWheel& t, Blackboard& bb, const uint64_t agent = 0) :
+			agentId(agent), blackboard(bb), now(t.now()), timers(t), rng(agent) {}
+
+		uint64_t agentId;					// the agent being ticked
+		Blackboard& blackboard;				// the agent's variables
+		TimerWheel::Clock::time_point now;	// sampled once at the beginning of the tick
+		uint64_t tickId = 0;				// incremented at each tick
+		TimerWheel& timers;					// deadlines of the time based nodes
+		Random rng;							// the agent's random numbers, seeded by its id
+		Arena scratch;						// per tick memory, released at the next tick
+		Tracer* tracer = nullptr;			// if set, notified of every node run
+	};
+
 	// This class represents each node in the behaviour tree.
 	class Node {
 	public:
-		explicit Node(const bool dontSkip = false) : _name(__func__), _dontSkip(dontSkip) {}
+		typedef uint32_t NameId;
+
+		explicit Node(const bool dontSkip = false) : _dontSkip(dontSkip) {}
 		Node(const std::string& name,
-			 const bool dontSkip = false) : _name(name), _dontSkip(dontSkip) {}
+			 const bool dontSkip = false) : _nameId(intern(name)), _dontSkip(dontSkip) {}
+		// Not to be taken for Node(bool) when given a literal.
+		Node(const char* name,
+			 const bool dontSkip = false) : _nameId(intern(name)), _dontSkip(dontSkip) {}
 
         virtual ~Node() = default;
 
-		virtual Status run() = 0;
+		virtual Status run(TickContext& ctx) = 0;
+		// What parents call to run a child: run() plus tracing when enabled.
+		// The tracer's exit() still sees the Status of the previous tick in getTickStatus().
+		Status tick(TickContext& ctx) {
+			if (ctx.tracer == nullptr)
+				return _ticked = run(ctx);
+			ctx.tracer->enter(*this, ctx);
+			const Status s = run(ctx);
+			ctx.tracer->exit(*this, ctx, s);
+			return _ticked = s;
+		}
+		// Abort a RUNNING node, so that its next run() starts over.
+		virtual void halt(TickContext& ctx) {
+			_completed = false;
+			_lastStatus = Status::NOTRUN;
+		}
+		// What a node remembers from one tick to the next.
+		struct State {
+			bool completed = false;
+			Status lastStatus = Status::NOTRUN;
+			Status ticked = Status::NOTRUN;
+			uint64_t data[4] = { 0, 0, 0, 0 };	// node specific
+		};
+		virtual void save(State& state) const {
+			state.completed = _completed;
+			state.lastStatus = _lastStatus;
+			state.ticked = _ticked;
+		}
+		virtual void restore(const State& state) {
+			_completed = state.completed;
+			_lastStatus = state.lastStatus;
+			_ticked = state.ticked;
+		}
+		// Take over the state of the same node in a previous version of the tree,
+		// which is guaranteed to be of the same type.
+		virtual void adopt(const Node& previous) {
+			State state;
+			previous.save(state);
+			restore(state);
+		}
+		// Append the blackboard variables the Status of the node depends on, for Incremental.
+		// @return false if it depends on anything else: time, randomness, the world...
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const { return false; }
 		
-		const std::string getName() const { return _name; }
+		// Names are kept out of the nodes, in a table only looked up for debugging and tracing.
+		const std::string getName() const { return nameOf(_nameId); }
+		NameId getNameId() const { return _nameId; }
+		void setName(const NameId id) { _nameId = id; }
+		void setName(const std::string& name) { _nameId = intern(name); }
 		const bool isCompleted() const { return _completed; }
 		const bool dontSkip() const { return _dontSkip; }
 		const Status  getLastStatus() const { return _lastStatus; }
+		// The Status returned by the latest tick().
+		const Status getTickStatus() const { return _ticked; }
+
+		// The same name always gives the same id. Id 0 is "Node", the name of unnamed nodes.
+		static NameId intern(const std::string& name) {
+			Names& n = names();
+			std::lock_guard<std::mutex> mlock(n.mutex);
+			auto it = n.ids.find(name);
+			if (it != n.ids.end()) return it->second;
+			const NameId id = static_cast<NameId>(n.names.size());
+			n.ids.emplace(name, id);
+			n.names.push_back(name);
+			return id;
+		}
+		static std::string nameOf(const NameId id) {
+			Names& n = names();
+			std::lock_guard<std::mutex> mlock(n.mutex);
+			return id < n.names.size() ? n.names[id] : std::string();
+		}
 
 	protected:
-		const std::string _name;
+		NameId _nameId = 0;
+		Status _lastStatus = Status::NOTRUN;
 		bool _dontSkip;						// never skip this node
 		bool _completed = false;
-		Status _lastStatus = Status::NOTRUN;
+		Status _ticked = Status::NOTRUN;
+
+	private:
+		struct Names {
+			Names() : ids{ { "Node", 0 } }, names{ "Node" } {}
+			std::mutex mutex;
+			std::unordered_map<std::string, NameId> ids;
+			std::vector<std::string> names;
+		};
+		static Names& names() {
+			static Names n;
+			return n;
+		}
 	};
+	// A vptr and a few bytes of state, so that many nodes share a cache line.
+	static_assert(sizeof(Node) <= 2 * sizeof(void*), "Node should stay compact");
 
 	//  This type of Node follows the Composite Pattern, containing a list of other Nodes.
 	class CompositeNode : public Node {
+	public:
+		// The first children are kept within the node itself.
+		typedef SmallVector<Node*, BT_INLINE_CHILDREN> Children;
 	private:
-		std::vector<Node*> children;
+		Children children;
 	public:
 		CompositeNode() = default;
 		virtual ~CompositeNode() {
@@ -65,11 +225,11 @@ public:
             children.clear();
         }
 
-		const std::vector<Node*>& getChildren() const {
+		const Children& getChildren() const {
 			return children;
 		}
 		void addChild(Node* child) {
-			children.emplace_back(child);
+			children.push_back(child);
 		}
 		void addChildren(std::initializer_list<Node*>&& newChildren) {
 			for (Node* child : newChildren) addChild(child);
@@ -78,6 +238,17 @@ public:
 		void addChildren(const CONTAINER& newChildren) {
 			for (Node* child : newChildren) addChild(child);
 		}
+		virtual void halt(TickContext& ctx) override {
+			for (Node* child : children) child->halt(ctx);
+			Node::halt(ctx);
+		}
+	protected:
+		// What all the children read, for the composites depending on nothing else.
+		bool childrenRead(std::vector<Blackboard::Key>& keys) const {
+			for (const Node* child : children)
+				if (!child->reads(keys)) return false;
+			return true;
+		}
 	};
 
 	// The generic Selector implementation
@@ -88,13 +259,13 @@ public:
 		// If one child succeeds, the entire run() succeeds,
 		// FAILURE only if all children fail,
 		// RUNNING if at least one of the children is RUNNING and no other is in SUCCESS or ERROR.
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Status s = Status::FAILURE;
 			bool hasRunningChild = false;
 			for (Node* child : getChildren()) {
 				if (child->dontSkip()) {
 					// run at each and every iteration
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 				}
 				else {
@@ -104,7 +275,7 @@ public:
 						s = child->getLastStatus();
 					}
 					else {
-						s = child->run();
+						s = child->tick(ctx);
 						_lastStatus = s;
 					}
 				}
@@ -123,6 +294,7 @@ public:
 			}
 			return s;  // All children failed so the entire run() operation fails.
 		}
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childrenRead(keys); }
 	};
 
 	// The generic Sequence implementation.
@@ -133,12 +305,12 @@ public:
 		// If one child fails, then the entire operation fails.
 		// SUCCESS only if all children succeed.
 		// RUNNING if at least one of the children is RUNNING and no other is in SUCCESS or ERROR.
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			for (Node* child : getChildren()) {
 				Status s;
 				if (child->dontSkip()) {
 					// run at each and every iteration
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 				}
 				else {
@@ -148,12 +320,14 @@ public:
 						s = child->getLastStatus();
 					}
 					else {
-						s = child->run();
+						s = child->tick(ctx);
 						_lastStatus = s;
-						if (s != Status::RUNNING)
-							_completed = true;
 					}
 					if (s != Status::SUCCESS) {
+						// The sequence is only over once a child has a final Status:
+						// a RUNNING child is resumed at the next tick.
+						if (s != Status::RUNNING)
+							_completed = true;
 						return s;
 					}
 				}
@@ -165,8 +339,95 @@ public:
                 default: break;
 				}
 			}
+			_completed = true;
 			return Status::SUCCESS;  // All children suceeded, so the entire run() operation succeeds.
 		}
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childrenRead(keys); }
+	};
+
+	// Run the child of highest utility, scored for the agent being ticked.
+	// Each child's utility is either a float variable of the blackboard or a function;
+	// a NaN utility rules the child out, and children added without one score 0.
+	// The scores are gathered into an array and the best one is picked with SIMD.
+	// A RUNNING child is resumed without scoring again until it is over.
+	// FAILURE if no child can be chosen, otherwise the Status of the chosen child.
+	class UtilitySelect : public CompositeNode {
+	public:
+		typedef std::function<float(TickContext&)> Scorer;
+
+		void addChild(Node* child, const Blackboard::Key utility) {
+			CompositeNode::addChild(child);
+			_utilities.resize(getChildren().size());
+			_utilities.back().key = utility;
+			_utilities.back().fromBlackboard = true;
+		}
+		void addChild(Node* child, Scorer utility) {
+			CompositeNode::addChild(child);
+			_utilities.resize(getChildren().size());
+			_utilities.back().function = std::move(utility);
+		}
+		using CompositeNode::addChild;
+
+		// The utilities of the children for an agent. @param scores one per child
+		void score(TickContext& ctx, float* scores) {
+			const size_t n = getChildren().size();
+			for (size_t i = 0; i < n; i++) {
+				if (i >= _utilities.size())
+					scores[i] = 0.0f;
+				else if (_utilities[i].fromBlackboard)
+					scores[i] = ctx.blackboard.get<float>(_utilities[i].key, std::numeric_limits<float>::quiet_NaN());
+				else if (_utilities[i].function)
+					scores[i] = _utilities[i].function(ctx);
+				else
+					scores[i] = 0.0f;
+			}
+		}
+
+		virtual Status run(TickContext& ctx) override {
+			const size_t n = getChildren().size();
+			size_t chosen = _running - 1;
+			if (_running == NONE) {
+				float* scores = static_cast<float*>(ctx.scratch.allocate(n * sizeof(float), alignof(float)));
+				score(ctx, scores);
+				chosen = Simd::argmax(scores, n);
+				if (chosen == n) {
+					_lastStatus = Status::FAILURE;
+					return _lastStatus;
+				}
+			}
+			_lastStatus = getChildren()[chosen]->tick(ctx);
+			_running = _lastStatus == Status::RUNNING ? chosen + 1 : NONE;
+			return _lastStatus;
+		}
+		virtual void halt(TickContext& ctx) override {
+			_running = NONE;
+			CompositeNode::halt(ctx);
+		}
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _running;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_running = static_cast<size_t>(state.data[0]);
+		}
+		// The utility variables too; a scoring function may read anything.
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override {
+			for (const Utility& u : _utilities) {
+				if (u.fromBlackboard) keys.push_back(u.key);
+				else if (u.function) return false;
+			}
+			return childrenRead(keys);
+		}
+	private:
+		struct Utility {
+			Blackboard::Key key = 0;
+			bool fromBlackboard = false;
+			Scorer function;
+		};
+		static const size_t NONE = 0;	// _running holds the child index + 1
+		std::vector<Utility> _utilities;
+		size_t _running = NONE;
 	};
 
 	// A Decorator adds a functionality to its child node.
@@ -175,10 +436,9 @@ public:
 	// on the type of decorator node.
 	class DecoratorNode : public Node {
 	private:
-		Node* child;  // Only one child allowed
-	protected:
-		Node* getChild() const { return child; }
+		Node* child = nullptr;  // Only one child allowed
 	public:
+		Node* getChild() const { return child; }
 		DecoratorNode() = default;
 		virtual ~DecoratorNode() {
             if (child != nullptr) {
@@ -187,30 +447,68 @@ public:
             }
         }
 		void setChild(Node* newChild) { child = newChild; }
+		bool hasChild() const { return child != nullptr; }
+		virtual void halt(TickContext& ctx) override {
+			if (child != nullptr) child->halt(ctx);
+			Node::halt(ctx);
+		}
+	protected:
+		// What the child reads, for the decorators depending on nothing else.
+		bool childReads(std::vector<Blackboard::Key>& keys) const {
+			return child != nullptr && child->reads(keys);
+		}
+		// The same, sorted and without duplicates: the variables to watch. Left empty if not all known.
+		bool childWatch(std::vector<Blackboard::Key>& keys) const {
+			if (!childReads(keys)) {
+				keys.clear();
+				return false;
+			}
+			std::sort(keys.begin(), keys.end());
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+			return true;
+		}
 	};
 
 	// Root of a BehaviourTree
 	class Root : public DecoratorNode {
 	private:
 		friend class BehaviourTree;
-		virtual Status run() override {
-			Status s = getChild()->run();
-			while (s == Status::RUNNING)
-				s = getChild()->run();
+
+		Status pass(TickContext& ctx, const TimerWheel::Clock::time_point now) {
+			return BehaviourTree::tick(*getChild(), ctx, now);
+		}
+		virtual Status run(TickContext& ctx) override {
+			Status s = pass(ctx, TimerWheel::Clock::now());
+			while (s == Status::RUNNING) {
+				pause(ctx.timers);
+				s = pass(ctx, TimerWheel::Clock::now());
+			}
 			return s;
 		}
+		// Between two passes, sleep until the next timer may fire, but for one wheel step at
+		// most: the nodes RUNNING for other reasons, e.g. Async ones, are polled as often.
+		static void pause(const TimerWheel& timers) {
+			if (timers.pending() == 0) {
+				std::this_thread::yield();
+				return;
+			}
+			const TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+			std::this_thread::sleep_until(std::min(timers.nextDeadline(), now + timers.resolution()));
+		}
 	};
 
 	// Negates the Status of the child.
 	// A child fails and it will return Status::SUCCESS to its parent,
 	// or a child succeeds and it will return Status::FAILURE to the parent.
 	class Invert : public DecoratorNode {
+	public:
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childReads(keys); }
 	private:
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Node* child = getChild();
 			if (child->dontSkip()) {
 				// run at each and every iteration
-				const Status s = child->run();
+				const Status s = child->tick(ctx);
 				_lastStatus = s;
 				switch (s)
 				{
@@ -227,7 +525,7 @@ public:
 					s = child->getLastStatus();
 				}
 				else {
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 					if (s != Status::RUNNING)
 						_completed = true;
@@ -248,12 +546,14 @@ public:
 	// where a Status::FAILURE is expected or anticipated,
 	// but you don�t want to abandon processing of a sequence that branch sits on.
 	class Succeed : public DecoratorNode {
+	public:
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childReads(keys); }
 	private:
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Node* child = getChild();
 			if (child->dontSkip()) {
 				// run at each and every iteration
-				const Status s = child->run();
+				const Status s = child->tick(ctx);
 				_lastStatus = s;
 				if (s == Status::ERROR || s == Status::RUNNING)
 					return s;
@@ -266,7 +566,7 @@ public:
 					s = child->getLastStatus();
 				}
 				else {
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 					if (s != Status::RUNNING)
 						_completed = true;
@@ -281,12 +581,14 @@ public:
 	// The opposite of a Succeeder, always returning fail.
 	// Note that this can be achieved also by using an Inverter and setting its child to a Succeeder.
 	class Fail : public DecoratorNode {
+	public:
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childReads(keys); }
 	private:
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Node* child = getChild();
 			if (child->dontSkip()) {
 				// run at each and every iteration
-				const Status s = child->run();
+				const Status s = child->tick(ctx);
 				_lastStatus = s;
 				if (s == Status::ERROR || s == Status::RUNNING)
 					return s;
@@ -299,7 +601,7 @@ public:
 					s = child->getLastStatus();
 				}
 				else {
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 					if (s != Status::RUNNING)
 						_completed = true;
@@ -321,11 +623,11 @@ public:
 		int _numRepeats;
 		static const int NOT_FOUND = -1;
 
-		void iterate(Status& s) {
+		void iterate(TickContext& ctx, Status& s) {
 			Node* child = getChild();
 			if (child->dontSkip()) {
 				// run at each and every iteration
-				s = child->run();
+				s = child->tick(ctx);
 			}
 			else {
 				// if the job has already done, return the status
@@ -334,7 +636,7 @@ public:
 					s = child->getLastStatus();
 				}
 				else {
-					s = child->run();
+					s = child->tick(ctx);
 					_lastStatus = s;
 					if (s != Status::RUNNING)
 						_completed = true;
@@ -342,19 +644,19 @@ public:
 			}
 		}
 
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Status s = Status::ERROR;
 			if (_numRepeats == NOT_FOUND)
 			{
 				// Loop indefinitely unless...
 				do {
-					iterate(s);
+					iterate(ctx, s);
 				} while (s != Status::ERROR && s != Status::RUNNING);
 			}
 			else {
 				for (int i = 0; i < _numRepeats; i++)
 				{
-					iterate(s);
+					iterate(ctx, s);
 					if (s == Status::ERROR || s == Status::RUNNING)
 						break;
 				}
@@ -371,13 +673,13 @@ public:
 	private:
 		std::chrono::microseconds _statusPoolTime;
 
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Node* child = getChild();
 
 			if (child->dontSkip()) {
 				// run at each and every iteration
 				std::future<Status> fut = std::async(std::launch::async, [&] {
-					return getChild()->run();
+					return getChild()->tick(ctx);
 				});
 				// if no answer within time delay
 				if (fut.wait_for(_statusPoolTime) == std::future_status::timeout) {
@@ -395,7 +697,7 @@ public:
 				}
 				else {
 					std::future<Status> fut = std::async(std::launch::async, [&] {
-						return getChild()->run();
+						return getChild()->tick(ctx);
 					});
 					// if no answer within time delay
 					if (fut.wait_for(_statusPoolTime) == std::future_status::timeout) {
@@ -411,14 +713,323 @@ public:
 		}
 	};
 
-	// Insert a delay in msec (1 msec by default) and return Status::SUCCESS
-	class Sleep : public DecoratorNode {
-		Sleep(const std::chrono::milliseconds msec = std::chrono::milliseconds(1)) : _msec(msec) {}
+	// Yield RUNNING for a delay in msec (1 msec by default), then return Status::SUCCESS.
+	// The delay is a deadline registered in the tree's TimerWheel: no thread is blocked.
+	class Sleep : public Node {
+	public:
+		explicit Sleep(const std::chrono::milliseconds msec = std::chrono::milliseconds(1)) : _msec(msec) {}
 	private:
 		std::chrono::milliseconds _msec;
-		virtual Status run() override {
-			std::this_thread::sleep_for(_msec);
-			return Status::SUCCESS;
+		TimerWheel::TimerId _timer = TimerWheel::INVALID;
+
+		virtual void halt(TickContext& ctx) override {
+			ctx.timers.cancel(_timer);
+			_timer = TimerWheel::INVALID;
+			Node::halt(ctx);
+		}
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _timer;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_timer = state.data[0];
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (_timer == TimerWheel::INVALID) {
+				_timer = ctx.timers.schedule(ctx.now + _msec);
+				_lastStatus = Status::RUNNING;
+			}
+			else if (ctx.timers.expired(_timer)) {
+				_timer = TimerWheel::INVALID;
+				_lastStatus = Status::SUCCESS;
+			}
+			return _lastStatus;
+		}
+	};
+
+	// Yield RUNNING for a delay in msec, then run the child and return its Status.
+	// The delay starts over once the child has returned a final Status.
+	class Wait : public DecoratorNode {
+	public:
+		explicit Wait(const std::chrono::milliseconds msec = std::chrono::milliseconds(1)) : _msec(msec) {}
+	private:
+		std::chrono::milliseconds _msec;
+		TimerWheel::TimerId _timer = TimerWheel::INVALID;
+		bool _waited = false;
+
+		virtual void halt(TickContext& ctx) override {
+			ctx.timers.cancel(_timer);
+			_timer = TimerWheel::INVALID;
+			_waited = false;
+			DecoratorNode::halt(ctx);
+		}
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _timer;
+			state.data[1] = _waited;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_timer = state.data[0];
+			_waited = state.data[1] != 0;
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (!_waited) {
+				if (_timer == TimerWheel::INVALID) {
+					_timer = ctx.timers.schedule(ctx.now + _msec);
+					return Status::RUNNING;
+				}
+				if (!ctx.timers.expired(_timer))
+					return Status::RUNNING;
+				_timer = TimerWheel::INVALID;
+				_waited = true;
+			}
+			_lastStatus = getChild()->tick(ctx);
+			if (_lastStatus != Status::RUNNING)
+				_waited = false;
+			return _lastStatus;
+		}
+	};
+
+	// Run the child, then refuse to run it again for a delay in msec:
+	// while cooling down, return Status::FAILURE without touching the child.
+	class Cooldown : public DecoratorNode {
+	public:
+		explicit Cooldown(const std::chrono::milliseconds msec = std::chrono::milliseconds(1)) : _msec(msec) {}
+	private:
+		std::chrono::milliseconds _msec;
+		TimerWheel::TimerId _timer = TimerWheel::INVALID;
+
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _timer;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_timer = state.data[0];
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (_timer != TimerWheel::INVALID) {
+				if (!ctx.timers.expired(_timer))
+					return Status::FAILURE;
+				_timer = TimerWheel::INVALID;
+			}
+			_lastStatus = getChild()->tick(ctx);
+			if (_lastStatus == Status::SUCCESS || _lastStatus == Status::FAILURE)
+				_timer = ctx.timers.schedule(ctx.now + _msec);
+			return _lastStatus;
+		}
+	};
+
+	// Fail and halt the child once it has been RUNNING for longer than a delay in msec.
+	// The deadline is checked against the time cached in the TickContext, so this is
+	// a mere comparison. Note that a child looping in place without ever yielding
+	// RUNNING (e.g. a RepeatUntil over synchronous leaves) can't be interrupted.
+	class Timeout : public DecoratorNode {
+	public:
+		explicit Timeout(const std::chrono::milliseconds msec = std::chrono::milliseconds(1)) : _msec(msec) {}
+	private:
+		std::chrono::milliseconds _msec;
+		TimerWheel::Clock::time_point _deadline;
+		bool _armed = false;
+
+		virtual void halt(TickContext& ctx) override {
+			_armed = false;
+			DecoratorNode::halt(ctx);
+		}
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = static_cast<uint64_t>(_deadline.time_since_epoch().count());
+			state.data[1] = _armed;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_deadline = TimerWheel::Clock::time_point(TimerWheel::Clock::duration(static_cast<TimerWheel::Clock::rep>(state.data[0])));
+			_armed = state.data[1] != 0;
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (!_armed) {
+				_deadline = ctx.now + _msec;
+				_armed = true;
+			}
+			else if (ctx.now >= _deadline) {
+				return expire(ctx);
+			}
+			_lastStatus = getChild()->tick(ctx);
+			if (_lastStatus != Status::RUNNING)
+				_armed = false;
+			else if (ctx.now >= _deadline)
+				return expire(ctx);
+			return _lastStatus;
+		}
+		Status expire(TickContext& ctx) {
+			getChild()->halt(ctx);
+			_armed = false;
+			_lastStatus = Status::FAILURE;
+			return _lastStatus;
+		}
+	};
+
+	// Run the child at most once per tick and agent: later passes through the Memo during
+	// the same tick, e.g. from other branches sharing it, return the cached Status.
+	// Writing one of the watched blackboard variables invalidates the cache within the tick.
+	// They are those given, or else those the subtree declares through Node::reads(), gathered
+	// at the first run; a subtree that doesn't declare them all keeps its Status for the tick.
+	// Meant for costly conditions reached several times per tick.
+	// Agents are told apart by their id and blackboard.
+	class Memo : public DecoratorNode {
+	public:
+		explicit Memo(std::vector<Blackboard::Key> watched = std::vector<Blackboard::Key>()) :
+			_watched(std::move(watched)), _gathered(!_watched.empty()) {}
+
+		const std::vector<Blackboard::Key>& getWatched() const { return _watched; }
+	private:
+		std::vector<Blackboard::Key> _watched;
+		bool _gathered;
+		uint64_t _tickId = 0;
+		uint64_t _agentId = 0;
+		const Blackboard* _blackboard = nullptr;
+		uint64_t _stamp = 0;				// of the watched variables, when cached
+
+		// The cached Status is _lastStatus, NOTRUN if none.
+		bool hit(const TickContext& ctx) const {
+			if (_lastStatus == Status::NOTRUN || _tickId != ctx.tickId || _agentId != ctx.agentId || _blackboard != &ctx.blackboard)
+				return false;
+			return stamp(ctx.blackboard, _watched) == _stamp;
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (!_gathered) {
+				_gathered = true;
+				childWatch(_watched);
+			}
+			if (hit(ctx))
+				return _lastStatus;
+			_lastStatus = getChild()->tick(ctx);
+			// After the child: its own writes don't count as changes.
+			_stamp = stamp(ctx.blackboard, _watched);
+			_tickId = ctx.tickId;
+			_agentId = ctx.agentId;
+			_blackboard = &ctx.blackboard;
+			return _lastStatus;
+		}
+		// The cache is part of the state, e.g. of each instance of a shared subtree.
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _tickId;
+			state.data[1] = _agentId;
+			state.data[2] = reinterpret_cast<uintptr_t>(_blackboard);
+			state.data[3] = _stamp;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_tickId = state.data[0];
+			_agentId = state.data[1];
+			_blackboard = reinterpret_cast<const Blackboard*>(static_cast<uintptr_t>(state.data[2]));
+			_stamp = state.data[3];
+		}
+		// But not across versions of the tree.
+		virtual void adopt(const Node& previous) override {
+			Node::adopt(previous);
+			_lastStatus = Status::NOTRUN;
+		}
+	public:
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return childReads(keys); }
+		// A sum of the versions of variables of a blackboard: as versions only grow,
+		// it changes whenever one of the variables is written or erased.
+		static uint64_t stamp(const Blackboard& blackboard, const std::vector<Blackboard::Key>& keys) {
+			uint64_t sum = 0;
+			for (const Blackboard::Key k : keys) sum += blackboard.version(k);
+			return sum;
+		}
+	};
+
+	// Tick the child again only once the blackboard variables it reads have changed: until
+	// then, each tick returns the final Status of its last run without entering the subtree.
+	// The variables are those the subtree declares through Node::reads(), gathered at the
+	// first run, or those given, e.g. for leaves that don't declare theirs. A subtree that
+	// depends on anything else, or whose variables aren't known, is ticked as usual.
+	// A RUNNING child is always resumed; a changed one is halted, to be evaluated afresh.
+	// Halting the Incremental keeps the cache: a final Status stays valid, only a RUNNING
+	// child is aborted. The cache is that of one agent, the last ticked, told apart by its
+	// id and blackboard.
+	class Incremental : public DecoratorNode {
+	public:
+		explicit Incremental(std::vector<Blackboard::Key> watched = std::vector<Blackboard::Key>()) :
+			_watched(std::move(watched)), _declared(!_watched.empty()) {}
+
+		// Whether the subtree's variables are known, once it has run.
+		bool isTracked() const { return _declared; }
+		const std::vector<Blackboard::Key>& getWatched() const { return _watched; }
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override {
+			if (_declared) keys.insert(keys.end(), _watched.begin(), _watched.end());
+			return _declared || childReads(keys);
+		}
+	private:
+		std::vector<Blackboard::Key> _watched;
+		uint64_t _agentId = 0;
+		const Blackboard* _blackboard = nullptr;
+		uint64_t _stamp = 0;				// of the watched variables, at the last run
+		Status _cached = Status::NOTRUN;	// the last final Status, NOTRUN if none
+		bool _declared;
+		bool _gathered = false;
+
+		bool sameAgent(const TickContext& ctx) const {
+			return _agentId == ctx.agentId && _blackboard == &ctx.blackboard;
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (!_gathered) {
+				_gathered = true;
+				if (!_declared) _declared = childWatch(_watched);
+			}
+			if (!_declared)
+				return _lastStatus = getChild()->tick(ctx);
+			if (_cached != Status::NOTRUN && sameAgent(ctx) && Memo::stamp(ctx.blackboard, _watched) == _stamp)
+				return _cached;
+			// Start over unless resuming: the composites below remember their finished children.
+			if (_lastStatus != Status::RUNNING || !sameAgent(ctx))
+				getChild()->halt(ctx);
+			_lastStatus = getChild()->tick(ctx);
+			// After the child: its own writes don't count as changes.
+			_stamp = Memo::stamp(ctx.blackboard, _watched);
+			_agentId = ctx.agentId;
+			_blackboard = &ctx.blackboard;
+			_cached = _lastStatus == Status::RUNNING ? Status::NOTRUN : _lastStatus;
+			return _lastStatus;
+		}
+		// The cache is part of the state, e.g. of each instance of a shared subtree.
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = _agentId;
+			state.data[1] = reinterpret_cast<uintptr_t>(_blackboard);
+			state.data[2] = _stamp;
+			state.data[3] = static_cast<uint64_t>(static_cast<uint8_t>(_cached));
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_agentId = state.data[0];
+			_blackboard = reinterpret_cast<const Blackboard*>(static_cast<uintptr_t>(state.data[1]));
+			_stamp = state.data[2];
+			// A state saved before any run has no blackboard.
+			_cached = _blackboard == nullptr ? Status::NOTRUN : static_cast<Status>(static_cast<int8_t>(state.data[3]));
+		}
+		// But not across versions of the tree, whose subtree may differ.
+		virtual void adopt(const Node& previous) override {
+			Node::adopt(previous);
+			_cached = Status::NOTRUN;
+		}
+	};
+
+	// Succeed with a given probability, drawn from the agent's random number generator:
+	// replaying an agent with the same seed replays the same outcomes.
+	class Probability : public Node {
+	public:
+		explicit Probability(const double probability) : _probability(probability) {}
+	private:
+		double _probability;
+		virtual Status run(TickContext& ctx) override {
+			_lastStatus = ctx.rng.chance(_probability) ? Status::SUCCESS : Status::FAILURE;
+			return _lastStatus;
 		}
 	};
 
@@ -432,14 +1043,14 @@ public:
 					const Status exitStatus) : _exitStatus(exitStatus) {}
 	private:
 		Status _exitStatus;
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			Status s;
 			Node* child = getChild();
 			if (child->dontSkip()) {
 				// run at each and every iteration
-				s = getChild()->run();
+				s = getChild()->tick(ctx);
 				while (s != _exitStatus && s != Status::ERROR && s != Status::RUNNING) {
-					s = getChild()->run();
+					s = getChild()->tick(ctx);
 					_lastStatus = s;
 				}
 			}
@@ -450,9 +1061,9 @@ public:
 					s = child->getLastStatus();
 				}
 				else {
-					s = getChild()->run();
+					s = getChild()->tick(ctx);
 					while (s != _exitStatus && s != Status::ERROR && s != Status::RUNNING) {
-						s = getChild()->run();
+						s = getChild()->tick(ctx);
 						_lastStatus = s;
 						if (s != Status::RUNNING)
 							_completed = true;
@@ -463,26 +1074,160 @@ public:
 		}
 	};
 
+	class SubtreeRef;
+
+	// A subtree defined once and used by many trees through SubtreeRef.
+	// The nodes are shared: at any time they hold the state of the instance ticked last,
+	// the state of every other instance being kept by its SubtreeRef. It is swapped only when
+	// another instance is ticked, so that an instance ticked again finds its nodes as it left
+	// them. Ticks of the instances of a same definition are serialized.
+	class Subtree {
+	public:
+		explicit Subtree(Node* root) : _root(root) { collect(root); }
+		Subtree(const Subtree&) = delete;
+		Subtree& operator=(const Subtree&) = delete;
+
+		Node* root() const { return _root; }
+		size_t size() const { return _nodes.size(); }
+	private:
+		friend class SubtreeRef;
+		void collect(Node* node) {
+			_nodes.push_back(node);
+			if (const CompositeNode* composite = dynamic_cast<const CompositeNode*>(node)) {
+				for (Node* child : composite->getChildren()) collect(child);
+			}
+			else if (const DecoratorNode* decorator = dynamic_cast<const DecoratorNode*>(node)) {
+				if (decorator->hasChild()) collect(decorator->getChild());
+			}
+		}
+		Node* _root;
+		std::vector<Node*> _nodes;	// depth first, indexing the states of the instances
+		std::mutex _mutex;
+		SubtreeRef* _owner = nullptr;	// the instance whose state the nodes hold
+	};
+
+	// An instance of a shared Subtree: a leaf owning nothing but the state of the subtree's nodes,
+	// loaded into them when it is ticked after another instance, and saved back when another
+	// instance takes over.
+	class SubtreeRef : public Node {
+	public:
+		explicit SubtreeRef(Subtree& definition) : _definition(definition), _states(definition.size()) {}
+		~SubtreeRef() {
+			std::lock_guard<std::mutex> mlock(_definition._mutex);
+			if (_definition._owner == this) _definition._owner = nullptr;
+		}
+		SubtreeRef(const SubtreeRef&) = delete;
+		SubtreeRef& operator=(const SubtreeRef&) = delete;
+		const Subtree& getDefinition() const { return _definition; }
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override { return _definition._root->reads(keys); }
+	private:
+		Subtree& _definition;
+		std::vector<State> _states;		// a default State is the one of a node that never ran
+		void load() {
+			for (size_t i = 0; i < _states.size(); i++) _definition._nodes[i]->restore(_states[i]);
+		}
+		void store() {
+			for (size_t i = 0; i < _states.size(); i++) _definition._nodes[i]->save(_states[i]);
+		}
+		// Have the nodes hold the state of this instance, under the definition's lock.
+		void acquire() {
+			if (_definition._owner == this) return;
+			if (_definition._owner != nullptr) _definition._owner->store();
+			load();
+			_definition._owner = this;
+		}
+		virtual Status run(TickContext& ctx) override {
+			std::lock_guard<std::mutex> mlock(_definition._mutex);
+			acquire();
+			_lastStatus = _definition._root->tick(ctx);
+			_completed = _definition._root->isCompleted();
+			return _lastStatus;
+		}
+		virtual void halt(TickContext& ctx) override {
+			{
+				std::lock_guard<std::mutex> mlock(_definition._mutex);
+				acquire();
+				_definition._root->halt(ctx);
+			}
+			Node::halt(ctx);
+		}
+		virtual void adopt(const Node& previous) override {
+			const SubtreeRef& p = static_cast<const SubtreeRef&>(previous);
+			if (&p._definition == &_definition) {
+				std::lock_guard<std::mutex> mlock(_definition._mutex);
+				// The nodes hold the previous instance's state, which becomes this one's.
+				if (_definition._owner == &p) _definition._owner = this;
+				else _states = p._states;
+			}
+			Node::adopt(previous);
+		}
+	};
+
 	/// The following are useful nodes
 
 	// Stack nodes
+	// The stack is thread safe and may be shared by all the agents, whereas
+	// the items pushed and popped are variables of the agent's blackboard.
 	template <typename T>
 	class StackNode : public Node {
 	protected:
 		ConcurrentStack<T*>& stack;  // Must be reference to a stack to work.
-		StackNode(ConcurrentStack<T*>& s) : stack(s) {}
+		StackNode(ConcurrentStack<T*>& s,
+				  const std::chrono::milliseconds patience = std::chrono::milliseconds(0)) : stack(s), _patience(patience) {}
+
+		// Never block the tick thread on the stack: return RUNNING while it isn't ready,
+		// until the patience runs out.
+		Status notReady(TickContext& ctx, const Status giveUp) {
+			if (_patience == std::chrono::milliseconds::max())
+				return Status::RUNNING;
+			if (!_waiting) {
+				_waiting = true;
+				_deadline = ctx.now + _patience;
+			}
+			if (ctx.now < _deadline)
+				return Status::RUNNING;
+			_waiting = false;
+			return giveUp;
+		}
+		void ready() { _waiting = false; }
+	private:
+		std::chrono::milliseconds _patience;
+		TimerWheel::Clock::time_point _deadline;
+		bool _waiting = false;
+
+		virtual void halt(TickContext& ctx) override {
+			_waiting = false;
+			Node::halt(ctx);
+		}
+		virtual void save(State& state) const override {
+			Node::save(state);
+			state.data[0] = static_cast<uint64_t>(_deadline.time_since_epoch().count());
+			state.data[1] = _waiting;
+		}
+		virtual void restore(const State& state) override {
+			Node::restore(state);
+			_deadline = TimerWheel::Clock::time_point(TimerWheel::Clock::duration(static_cast<TimerWheel::Clock::rep>(state.data[0])));
+			_waiting = state.data[1] != 0;
+		}
 	};
 
 	// Specific type of leaf (hence has no child).
+	// RUNNING while the stack is full, FAILURE once it has been full for longer than the patience.
 	template <typename T>
 	class Push : public StackNode<T> {
 	private:
-		T*& item;
+		Blackboard::Key item;
 	public:
-		Push(T*& t, ConcurrentStack<T*>& s) : StackNode<T>(s), item(t) {}
+		Push(const Blackboard::Key t, ConcurrentStack<T*>& s,
+			 const std::chrono::milliseconds patience = std::chrono::milliseconds::max()) : StackNode<T>(s, patience), item(t) {}
 	private:
-		virtual Status run() override {
-			this->stack.push(item);
+		virtual Status run(TickContext& ctx) override {
+			T** object = ctx.blackboard.find<T*>(item);
+			if (object == nullptr)
+				return Status::ERROR;
+			if (!this->stack.try_push_for(*object, std::chrono::milliseconds(0)))
+				return this->notReady(ctx, Status::FAILURE);
+			this->ready();
 			return Status::SUCCESS;
 		}
 	};
@@ -497,7 +1242,7 @@ public:
 		GetStack(ConcurrentStack<T*>& s, const ConcurrentStack<T*>& o, T* t = nullptr) :
         StackNode<T>(s), obtainedStack(o), object(t) {}
 	private:
-		virtual Status run() override {
+		virtual Status run(TickContext& ctx) override {
 			this->stack = obtainedStack;
 			if (object)
 				this->stack.push(std::move(object));
@@ -506,20 +1251,23 @@ public:
 	};
 
 	// Specific type of leaf (hence has no child).
+	// FAILURE if the stack is empty, or with some patience, RUNNING until it has been empty for that long.
 	template <typename T>
 	class Pop : public StackNode<T> {
 	private:
-		T*& item;
+		Blackboard::Key item;
 	public:
-		Pop(T*& t, ConcurrentStack<T*>& s) : StackNode<T>(s), item(t) {}
+		Pop(const Blackboard::Key t, ConcurrentStack<T*>& s,
+			const std::chrono::milliseconds patience = std::chrono::milliseconds(0)) : StackNode<T>(s, patience), item(t) {}
 	private:
-		virtual Status run() override {
-			if (this->stack.is_empty())
-				return Status::FAILURE;
-			item = this->stack.top();
+		virtual Status run(TickContext& ctx) override {
+			T* object;
+			if (!this->stack.try_pop_for(object, std::chrono::milliseconds(0)))
+				return this->notReady(ctx, Status::FAILURE);
+			this->ready();
+			ctx.blackboard.set(item, object);
 			// template specialization with T = Door needed for this line actually
-			std::cout << "Trying to get through door #" << item->doorNumber << "." << std::endl;
-			this->stack.pop();
+			std::cout << "Trying to get through door #" << object->doorNumber << "." << std::endl;
 			return Status::SUCCESS;
 		}
 	};
@@ -530,8 +1278,8 @@ public:
 	public:
 		StackIsEmpty(ConcurrentStack<T*>& s) : StackNode<T>(s) {}
 	private:
-		virtual Status run() override {
-			if (this->stack.empty())
+		virtual Status run(TickContext& ctx) override {
+			if (this->stack.is_empty())
 				return Status::SUCCESS;
 			else
 				return Status::FAILURE;
@@ -539,43 +1287,75 @@ public:
 	};
 
 	// Specific type of leaf (hence has no child).
+	// Copy a blackboard variable into another one.
 	template <typename T>
 	class SetVar : public BehaviourTree::Node {
 	private:
-        std::mutex mutex_;
-		T*& variable, *& object;  // Must use reference to pointer to work correctly.
+		Blackboard::Key variable, object;
 	public:
-		SetVar(T*& t, T*& obj) : variable(t), object(obj) {}
-		virtual Status run() override {
-            std::lock_guard<std::mutex> mlock(mutex_);
-			variable = object;
+		SetVar(const Blackboard::Key t, const Blackboard::Key obj) : variable(t), object(obj) {}
+		virtual Status run(TickContext& ctx) override {
+			T* value = ctx.blackboard.get<T*>(object);
+			ctx.blackboard.set(variable, value);
 			// template specialization with T = Door needed for this line actually
-			std::cout << "The door that was used to get in is door #" << variable->doorNumber << "." << std::endl;
+			std::cout << "The door that was used to get in is door #" << value->doorNumber << "." << std::endl;
 			return Status::SUCCESS;
 		};
 	};
 
 	// Specific type of leaf (hence has no child).
+	// SUCCESS if the blackboard variable is nullptr or was never set.
 	template <typename T>
 	class IsNull : public BehaviourTree::Node {
 	private:
-		T*& object;  // Must use reference to pointer to work correctly.
+		Blackboard::Key object;
 	public:
-		IsNull(T*& t) : object(t) {}
-		virtual Status run() override {
-			if (object == nullptr)
+		IsNull(const Blackboard::Key t) : object(t) {}
+		virtual bool reads(std::vector<Blackboard::Key>& keys) const override {
+			keys.push_back(object);
+			return true;
+		}
+		virtual Status run(TickContext& ctx) override {
+			if (ctx.blackboard.get<T*>(object) == nullptr)
 				return Status::SUCCESS;
 			else
 				return Status::FAILURE;
 		}
 	};
 
-
 public:
-	BehaviourTree() : root(new Root) {}
+	BehaviourTree() : context(timers, blackboard), root(new Root) {}
+	~BehaviourTree() { delete root; }
+	BehaviourTree(const BehaviourTree&) = delete;
+	BehaviourTree& operator=(const BehaviourTree&) = delete;
+
 	void setRootChild(Node* rootChild) const { root->setChild(rootChild); }
-	Status run() const { return root->run(); }
+	// Run the tree until it returns a final Status.
+	Status run() { return root->run(context); }
+	// Run a single pass through the tree, which may return Status::RUNNING.
+	Status tick() { return root->pass(context, TimerWheel::Clock::now()); }
+	Status tick(const TimerWheel::Clock::time_point now) { return root->pass(context, now); }
+	// Run a single pass on behalf of another agent, whose context was made with getTimers().
+	Status tick(TickContext& agent) { return root->pass(agent, TimerWheel::Clock::now()); }
+	Status tick(TickContext& agent, const TimerWheel::Clock::time_point now) { return root->pass(agent, now); }
+	// A single pass through any tree: sample the clock once for all the nodes,
+	// expire the timers that are due and release the previous tick's scratch memory.
+	static Status tick(Node& root, TickContext& ctx, const TimerWheel::Clock::time_point now) {
+		ctx.now = now;
+		++ctx.tickId;
+		ctx.scratch.reset();
+		ctx.timers.advance(now);
+		return root.tick(ctx);
+	}
+	// Deadlines of the time based nodes (Sleep, Wait, Cooldown).
+	TimerWheel& getTimers() { return timers; }
+	// The default agent's context and variables, used by run() and tick().
+	TickContext& getContext() { return context; }
+	Blackboard& getBlackboard() { return blackboard; }
 
 private:
+	TimerWheel timers;
+	Blackboard blackboard;
+	TickContext context;
 	Root* root;
 };
@@ -32,10 +32,11 @@ private:
 typedef BehaviourTree BT;
 
 // Acts as a storage for arbitrary variables that are interpreted and altered by the nodes.
+// The doors still to try are shared, whereas the variables are in the agent's blackboard.
 struct DataContext {
 	ConcurrentStack<Door*> doors;
-	Door* currentDoor = nullptr;
-	Door* usedDoor = nullptr;
+	const Blackboard::Key currentDoor = Blackboard::key("currentDoor");
+	const Blackboard::Key usedDoor = Blackboard::key("usedDoor");
 };
 
 class DoorAction : public BT::Node {
@@ -46,8 +47,8 @@ public:
 	DoorAction(const std::string& newName, int prob) :
     name(newName), probabilityOfSuccess(prob) {}
 private:
-	BT::Status run() override {
-		if (std::rand() % 100 < probabilityOfSuccess) {
+	BT::Status run(BT::TickContext& ctx) override {
+		if (ctx.rng.below(100) < static_cast<uint32_t>(probabilityOfSuccess)) {
 			std::cout << name << " succeeded." << std::endl;
 			return BT::Status::SUCCESS;
 		}
@@ -57,9 +58,8 @@ private:
 };
 
 int main() {
-	std::srand(42);
-
 	BT behaviorTree;
+	behaviorTree.getContext().rng.seed(42);
 	DataContext data;
 
 	Building building(5);  // Building with 5 doors to get in.
@@ -0,0 +1,346 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include "NodeRegistry.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define BT_HAS_MMAP 1
+#endif
+
+
+/*
+* Compact binary tree format, laid out to be used in place from a memory
+* mapped file: every section is an array of fixed size little endian records,
+* and nodes refer to their children and parameters by index.
+*
+*   Header
+*   uint32_t    typeNames[typeCount]    offsets in the string table, padded to 8 bytes
+*   NodeRecord  nodes[nodeCount]        node 0 is the root
+*   uint32_t    children[childCount]    node indices, contiguous per parent, padded to 8 bytes
+*   ParamRecord params[paramCount]      contiguous per node
+*   char        strings[stringBytes]    NUL terminated
+*
+* Node types are resolved once per file against a NodeRegistry, then nodes are
+* built straight from their records, without any parsing.
+*/
+namespace BinaryTree {
+
+    static const char MAGIC[4] = { 'B', 'T', 'B', '1' };
+    static const uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t typeCount;
+        uint32_t nodeCount;
+        uint32_t childCount;
+        uint32_t paramCount;
+        uint32_t stringBytes;
+        uint32_t reserved;
+    };
+
+    struct NodeRecord {
+        uint32_t type;          // index in typeNames
+        uint32_t id;            // stable id, defaults to the node index
+        uint32_t firstChild;
+        uint32_t childCount;
+        uint32_t firstParam;
+        uint32_t paramCount;
+    };
+
+    struct ParamRecord {
+        uint32_t name;          // offset in the string table
+        uint32_t kind;          // NodeParams::Kind
+        union {
+            int64_t integer;
+            double real;
+            uint64_t string;    // offset in the string table
+        };
+    };
+
+    // Keep the 64 bit parameters aligned.
+    inline uint64_t padded(const uint64_t words) { return (words + 1) & ~uint64_t(1); }
+
+    static_assert(sizeof(Header) == 32, "unexpected padding");
+    static_assert(sizeof(NodeRecord) == 24, "unexpected padding");
+    static_assert(sizeof(ParamRecord) == 16, "unexpected padding");
+
+    // Parameters of one node, read in place.
+    class RecordParams : public NodeParams {
+    public:
+        RecordParams(const ParamRecord* params, size_t count, const char* strings) :
+            params_(params), count_(count), strings_(strings) {}
+        virtual size_t size() const override { return count_; }
+        virtual const char* name(size_t i) const override { return strings_ + params_[i].name; }
+        virtual Kind kind(size_t i) const override { return static_cast<Kind>(params_[i].kind); }
+        virtual int64_t integer(size_t i) const override { return params_[i].integer; }
+        virtual double real(size_t i) const override { return params_[i].real; }
+        virtual const char* string(size_t i) const override { return strings_ + params_[i].string; }
+    private:
+        const ParamRecord* params_;
+        size_t count_;
+        const char* strings_;
+    };
+
+    /*
+    * Builds a binary tree description.
+    * Nodes may be added in any order, as long as the root is the first one.
+    */
+    class Writer {
+    public:
+        // @return the index of the new node
+        uint32_t addNode(const std::string& type, const ParamList& params = ParamList(),
+                         const uint32_t id = UINT32_MAX) {
+            Node n;
+            n.type = type;
+            n.params = params;
+            n.id = id == UINT32_MAX ? static_cast<uint32_t>(nodes_.size()) : id;
+            nodes_.push_back(n);
+            return static_cast<uint32_t>(nodes_.size() - 1);
+        }
+
+        void addChild(const uint32_t parent, const uint32_t child) {
+            nodes_[parent].children.push_back(child);
+        }
+
+        std::vector<char> serialize() const {
+            std::vector<uint32_t> typeNames;
+            std::vector<NodeRecord> nodes;
+            std::vector<uint32_t> children;
+            std::vector<ParamRecord> params;
+            std::string strings;
+            std::vector<std::string> types;
+
+            for (const Node& n : nodes_) {
+                uint32_t type = 0;
+                while (type < types.size() && types[type] != n.type) type++;
+                if (type == types.size()) {
+                    types.push_back(n.type);
+                    typeNames.push_back(intern(strings, n.type));
+                }
+                NodeRecord r;
+                r.type = type;
+                r.id = n.id;
+                r.firstChild = static_cast<uint32_t>(children.size());
+                r.childCount = static_cast<uint32_t>(n.children.size());
+                r.firstParam = static_cast<uint32_t>(params.size());
+                r.paramCount = static_cast<uint32_t>(n.params.size());
+                nodes.push_back(r);
+                children.insert(children.end(), n.children.begin(), n.children.end());
+                for (size_t i = 0; i < n.params.size(); i++) {
+                    ParamRecord p;
+                    p.name = intern(strings, n.params.name(i));
+                    p.kind = static_cast<uint32_t>(n.params.kind(i));
+                    switch (n.params.kind(i)) {
+                    case NodeParams::Kind::INTEGER: p.integer = n.params.integer(i); break;
+                    case NodeParams::Kind::REAL: p.real = n.params.real(i); break;
+                    case NodeParams::Kind::STRING: p.string = intern(strings, n.params.string(i)); break;
+                    }
+                    params.push_back(p);
+                }
+            }
+
+            Header h;
+            std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+            h.version = VERSION;
+            h.typeCount = static_cast<uint32_t>(typeNames.size());
+            h.nodeCount = static_cast<uint32_t>(nodes.size());
+            h.childCount = static_cast<uint32_t>(children.size());
+            h.paramCount = static_cast<uint32_t>(params.size());
+            h.stringBytes = static_cast<uint32_t>(strings.size());
+            h.reserved = 0;
+
+            typeNames.resize(padded(typeNames.size()), 0);
+            children.resize(padded(children.size()), 0);
+            std::vector<char> out;
+            append(out, &h, sizeof(h));
+            append(out, typeNames.data(), typeNames.size() * sizeof(uint32_t));
+            append(out, nodes.data(), nodes.size() * sizeof(NodeRecord));
+            append(out, children.data(), children.size() * sizeof(uint32_t));
+            append(out, params.data(), params.size() * sizeof(ParamRecord));
+            append(out, strings.data(), strings.size());
+            return out;
+        }
+
+        bool save(const std::string& path) const {
+            const std::vector<char> data = serialize();
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            return static_cast<bool>(file);
+        }
+
+    private:
+        struct Node {
+            std::string type;
+            ParamList params;
+            uint32_t id;
+            std::vector<uint32_t> children;
+        };
+
+        static uint32_t intern(std::string& strings, const std::string& s) {
+            const size_t found = strings.find(s + '\0');
+            if (found != std::string::npos && (found == 0 || strings[found - 1] == '\0'))
+                return static_cast<uint32_t>(found);
+            const uint32_t offset = static_cast<uint32_t>(strings.size());
+            strings += s;
+            strings += '\0';
+            return offset;
+        }
+
+        static void append(std::vector<char>& out, const void* data, const size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+
+        std::vector<Node> nodes_;
+    };
+
+    /**
+     * Instantiate a tree from a binary description held in memory.
+     * @return nullptr if the description is malformed or uses unknown node types
+     */
+    inline std::unique_ptr<LoadedTree> load(const void* data, const size_t size,
+                                            const NodeRegistry& registry, std::string* error = nullptr) {
+        std::unique_ptr<LoadedTree> tree;
+        const char* base = static_cast<const char*>(data);
+        if (size < sizeof(Header)) {
+            LoadedTree::fail(error, "truncated header");
+            return tree;
+        }
+        Header h;
+        std::memcpy(&h, base, sizeof(h));
+        if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION) {
+            LoadedTree::fail(error, "not a binary tree, or unsupported version");
+            return tree;
+        }
+        const uint64_t expected = sizeof(Header) + padded(h.typeCount) * sizeof(uint32_t)
+                + uint64_t(h.nodeCount) * sizeof(NodeRecord) + padded(h.childCount) * sizeof(uint32_t)
+                + uint64_t(h.paramCount) * sizeof(ParamRecord) + h.stringBytes;
+        if (expected != size || h.nodeCount == 0 || h.stringBytes == 0 || base[size - 1] != '\0') {
+            LoadedTree::fail(error, "inconsistent section sizes");
+            return tree;
+        }
+        const uint32_t* typeNames = reinterpret_cast<const uint32_t*>(base + sizeof(Header));
+        const NodeRecord* nodes = reinterpret_cast<const NodeRecord*>(typeNames + padded(h.typeCount));
+        const uint32_t* children = reinterpret_cast<const uint32_t*>(nodes + h.nodeCount);
+        const ParamRecord* params = reinterpret_cast<const ParamRecord*>(children + padded(h.childCount));
+        const char* strings = reinterpret_cast<const char*>(params + h.paramCount);
+
+        // Resolve the type table once.
+        std::vector<uint32_t> factories(h.typeCount);
+        for (uint32_t t = 0; t < h.typeCount; t++) {
+            if (typeNames[t] >= h.stringBytes) {
+                LoadedTree::fail(error, "type name out of bounds");
+                return tree;
+            }
+            factories[t] = registry.id(strings + typeNames[t]);
+            if (factories[t] == NodeRegistry::NOT_FOUND) {
+                LoadedTree::fail(error, std::string("unknown node type ") + (strings + typeNames[t]));
+                return tree;
+            }
+        }
+
+        tree.reset(new LoadedTree);
+        for (uint32_t i = 0; i < h.nodeCount; i++) {
+            const NodeRecord& n = nodes[i];
+            bool valid = n.type < h.typeCount && uint64_t(n.firstChild) + n.childCount <= h.childCount
+                    && uint64_t(n.firstParam) + n.paramCount <= h.paramCount;
+            for (uint32_t p = 0; valid && p < n.paramCount; p++) {
+                const ParamRecord& r = params[n.firstParam + p];
+                valid = r.name < h.stringBytes && r.kind <= static_cast<uint32_t>(NodeParams::Kind::STRING)
+                        && (r.kind != static_cast<uint32_t>(NodeParams::Kind::STRING) || r.string < h.stringBytes);
+            }
+            if (!valid) {
+                LoadedTree::fail(error, "node " + std::to_string(i) + " out of bounds");
+                tree.reset();
+                return tree;
+            }
+            const RecordParams p(params + n.firstParam, n.paramCount, strings);
+            if (!tree->add(registry.create(factories[n.type], tree->arena(), p), n.id, error)) {
+                tree.reset();
+                return tree;
+            }
+        }
+        // Every node but the root must have exactly one parent.
+        std::vector<bool> parented(h.nodeCount, false);
+        for (uint32_t i = 0; i < h.nodeCount; i++) {
+            const NodeRecord& n = nodes[i];
+            for (uint32_t c = 0; c < n.childCount; c++) {
+                const uint32_t child = children[n.firstChild + c];
+                if (child == 0 || child >= h.nodeCount || parented[child]) {
+                    LoadedTree::fail(error, "node " + std::to_string(i) + " has an invalid child");
+                    tree.reset();
+                    return tree;
+                }
+                parented[child] = true;
+                if (!tree->link(i, child, error)) {
+                    tree.reset();
+                    return tree;
+                }
+            }
+        }
+        // With one parent each, the nodes form a tree if all are reached from the root,
+        // and not orphans or cycles of their own.
+        std::vector<uint32_t> pending(1, 0);
+        uint32_t reached = 0;
+        while (!pending.empty()) {
+            const NodeRecord& n = nodes[pending.back()];
+            pending.pop_back();
+            ++reached;
+            pending.insert(pending.end(), children + n.firstChild, children + n.firstChild + n.childCount);
+        }
+        if (reached != h.nodeCount) {
+            LoadedTree::fail(error, std::to_string(h.nodeCount - reached) + " nodes not reachable from the root");
+            tree.reset();
+            return tree;
+        }
+        if (!tree->validate(error)) {
+            tree.reset();
+            return tree;
+        }
+        tree->setRoot(0);
+        return tree;
+    }
+
+    /**
+     * Instantiate a tree from a binary file, memory mapped where available.
+     * @return nullptr if the file can't be read or is malformed
+     */
+    inline std::unique_ptr<LoadedTree> load(const std::string& path, const NodeRegistry& registry,
+                                            std::string* error = nullptr) {
+#ifdef BT_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0 || st.st_size == 0) {
+            if (fd >= 0) ::close(fd);
+            LoadedTree::fail(error, "can't open " + path);
+            return std::unique_ptr<LoadedTree>();
+        }
+        const size_t size = static_cast<size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            LoadedTree::fail(error, "can't map " + path);
+            return std::unique_ptr<LoadedTree>();
+        }
+        std::unique_ptr<LoadedTree> tree = load(mapped, size, registry, error);
+        ::munmap(mapped, size);
+        return tree;
+#else
+        std::ifstream file(path, std::ios::binary);
+        const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (data.empty()) {
+            LoadedTree::fail(error, "can't open " + path);
+            return std::unique_ptr<LoadedTree>();
+        }
+        return load(data.data(), data.size(), registry, error);
+#endif
+    }
+}
@@ -0,0 +1,137 @@
+//
+// Binary tree format: write, map and instantiate through the node registry.
+//
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include "BinaryTree.h"
+
+typedef BehaviourTree BT;
+
+// A user leaf with parameters.
+class Counter : public BT::Node {
+public:
+	explicit Counter(BT::Status result) : result(result) {}
+	int runs = 0;
+	BT::Status result;
+	BT::Status run(BT::TickContext&) override { ++runs; return result; }
+};
+
+NodeRegistry makeRegistry() {
+	NodeRegistry registry = NodeRegistry::withBuiltins();
+	registry.add("Counter", [](Arena& a, const NodeParams& p) -> BT::Node* {
+		return a.create<Counter>(p.getStatus("result", BT::Status::SUCCESS));
+	});
+	return registry;
+}
+
+// Sequence[ Repeat(3)[Counter], Invert[Counter(FAILURE)], Select[Probability(0), Counter] ]
+BinaryTree::Writer makeWriter() {
+	BinaryTree::Writer w;
+	const uint32_t sequence = w.addNode("Sequence", ParamList(), 100);
+	const uint32_t repeat = w.addNode("Repeat", ParamList().set("count", 3));
+	const uint32_t counter = w.addNode("Counter");
+	const uint32_t invert = w.addNode("Invert");
+	const uint32_t failing = w.addNode("Counter", ParamList().set("result", "FAILURE"));
+	const uint32_t select = w.addNode("Select");
+	const uint32_t never = w.addNode("Probability", ParamList().set("p", 0.0));
+	const uint32_t last = w.addNode("Counter");
+	w.addChild(sequence, repeat);
+	w.addChild(repeat, counter);
+	w.addChild(sequence, invert);
+	w.addChild(invert, failing);
+	w.addChild(sequence, select);
+	w.addChild(select, never);
+	w.addChild(select, last);
+	return w;
+}
+
+void testRoundTrip() {
+	const NodeRegistry registry = makeRegistry();
+	const std::string path = "BinaryTree_test.btb";
+	const bool saved = makeWriter().save(path);
+	assert(saved);
+
+	std::string error;
+	std::unique_ptr<LoadedTree> loaded = BinaryTree::load(path, registry, &error);
+	std::remove(path.c_str());
+	assert(loaded && error.empty());
+	assert(loaded->size() == 8);
+	assert(loaded->id(0) == 100 && loaded->id(1) == 1);
+	assert(loaded->node(2)->getName() == "Counter");
+	assert(loaded->node(2)->getNameId() == loaded->node(4)->getNameId());
+	assert(Counter(BT::Status::SUCCESS).getName() == "Node");
+
+	BT tree;
+	tree.setRootChild(loaded->root());
+	assert(tree.tick() == BT::Status::SUCCESS);
+	assert(static_cast<Counter*>(loaded->node(2))->runs == 3);
+	assert(static_cast<Counter*>(loaded->node(4))->runs == 1);
+	assert(static_cast<Counter*>(loaded->node(7))->runs == 1);
+}
+
+void testMalformed() {
+	const NodeRegistry registry = makeRegistry();
+	std::string error;
+	std::vector<char> data = makeWriter().serialize();
+
+	assert(!BinaryTree::load(data.data(), data.size() - 1, registry, &error));
+	assert(!error.empty());
+
+	std::vector<char> corrupted = data;
+	corrupted[0] = 'X';
+	assert(!BinaryTree::load(corrupted.data(), corrupted.size(), registry, &error));
+
+	// Unknown node types are reported, not guessed.
+	assert(!BinaryTree::load(data.data(), data.size(), NodeRegistry::withBuiltins(), &error));
+	assert(error == "unknown node type Counter");
+
+	// A decorator with two children.
+	BinaryTree::Writer w;
+	const uint32_t invert = w.addNode("Invert");
+	w.addChild(invert, w.addNode("Counter"));
+	w.addChild(invert, w.addNode("Counter"));
+	data = w.serialize();
+	assert(!BinaryTree::load(data.data(), data.size(), registry, &error));
+
+	// Two nodes under the same id, which would mix up their states on a reload.
+	BinaryTree::Writer twice;
+	const uint32_t root = twice.addNode("Sequence", ParamList(), 5);
+	twice.addChild(root, twice.addNode("Counter", ParamList(), 5));
+	data = twice.serialize();
+	assert(!BinaryTree::load(data.data(), data.size(), registry, &error));
+	assert(error == "duplicate node id 5");
+
+	// A cycle out of reach of the root.
+	BinaryTree::Writer cycle;
+	cycle.addNode("Sequence");
+	const uint32_t a = cycle.addNode("Invert"), b = cycle.addNode("Invert");
+	cycle.addChild(a, b);
+	cycle.addChild(b, a);
+	data = cycle.serialize();
+	assert(!BinaryTree::load(data.data(), data.size(), registry, &error));
+	assert(error == "2 nodes not reachable from the root");
+
+	// A decorator without a child, which would crash the first tick.
+	BinaryTree::Writer childless;
+	const uint32_t sequence = childless.addNode("Sequence");
+	childless.addChild(sequence, childless.addNode("Invert"));
+	data = childless.serialize();
+	assert(!BinaryTree::load(data.data(), data.size(), registry, &error));
+	assert(error == "node 1 is a decorator without a child");
+
+	// A factory failing to make its node.
+	NodeRegistry failing = makeRegistry();
+	failing.add("Counter", [](Arena&, const NodeParams&) -> BT::Node* { return nullptr; });
+	data = makeWriter().serialize();
+	assert(!BinaryTree::load(data.data(), data.size(), failing, &error));
+	assert(error == "node 2 could not be created");
+}
+
+int main()
+{
+	testRoundTrip();
+	testMalformed();
+	std::cout << "BinaryTree tests passed." << std::endl;
+}
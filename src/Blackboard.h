@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+
+/*
+* Per agent storage for the variables read and written by the nodes.
+* Entries are addressed by keys interned once from their names, so that a
+* lookup is a mere index into a vector. Each variable carries a version number
+* bumped at every write and erase, which lets callers detect changes cheaply.
+* Versions never go back, so that a version seen once is never seen again
+* after a change.
+* A Blackboard is not thread safe: an agent is ticked by one thread at a time.
+*/
+class Blackboard
+{
+public:
+    typedef uint32_t Key;
+
+    /**
+     * Intern a variable name. The same name always gives the same key,
+     * in every blackboard.
+     */
+    static Key key(const std::string& name) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> mlock(r.mutex);
+        auto it = r.keys.find(name);
+        if (it != r.keys.end()) return it->second;
+        const Key k = static_cast<Key>(r.names.size());
+        r.keys.emplace(name, k);
+        r.names.push_back(name);
+        return k;
+    }
+
+    static std::string name(const Key key) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> mlock(r.mutex);
+        return key < r.names.size() ? r.names[key] : std::string();
+    }
+
+    Blackboard() = default;
+    Blackboard(const Blackboard&) = delete;
+    Blackboard& operator=(const Blackboard&) = delete;
+
+    // Write a variable, replacing any previous value, whatever its type.
+    template <typename T>
+    void set(const Key key, const T& value) {
+        if (key >= entries_.size()) {
+            entries_.resize(key + 1);
+            versions_.resize(key + 1, 0);
+        }
+        std::unique_ptr<Holder>& entry = entries_[key];
+        if (entry && entry->type == typeTag<T>())
+            static_cast<Value<T>*>(entry.get())->value = value;
+        else
+            entry.reset(new Value<T>(value));
+        ++versions_[key];
+    }
+
+    /**
+     * @return a pointer to the variable, or nullptr if it was never set
+     * or holds another type. Writing through it doesn't bump the version.
+     */
+    template <typename T>
+    T* find(const Key key) {
+        if (key >= entries_.size() || !entries_[key] || entries_[key]->type != typeTag<T>())
+            return nullptr;
+        return &static_cast<Value<T>*>(entries_[key].get())->value;
+    }
+
+    template <typename T>
+    T get(const Key key, const T& fallback = T()) {
+        T* value = find<T>(key);
+        return value ? *value : fallback;
+    }
+
+    bool has(const Key key) const {
+        return key < entries_.size() && entries_[key];
+    }
+
+    // 0 if the variable was never set, then incremented at each write and erase.
+    uint64_t version(const Key key) const {
+        return key < versions_.size() ? versions_[key] : 0;
+    }
+
+    // The version is kept, bumped: a later write doesn't bring back an earlier version.
+    void erase(const Key key) {
+        if (!has(key)) return;
+        entries_[key].reset();
+        ++versions_[key];
+    }
+
+private:
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<std::string, Key> keys;
+        std::vector<std::string> names;
+    };
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    // A unique address per type, cheaper than RTTI.
+    template <typename T>
+    static const void* typeTag() {
+        static const char tag = 0;
+        return &tag;
+    }
+
+    struct Holder {
+        explicit Holder(const void* t) : type(t) {}
+        virtual ~Holder() = default;
+        const void* type;
+    };
+
+    template <typename T>
+    struct Value : Holder {
+        explicit Value(const T& v) : Holder(typeTag<T>()), value(v) {}
+        T value;
+    };
+
+    std::vector<std::unique_ptr<Holder>> entries_;
+    std::vector<uint64_t> versions_;    // per key, outliving the erased entries
+};
@@ -0,0 +1,114 @@
+//
+// Blackboard, arena, random numbers and per agent tick contexts.
+//
+
+#include <iostream>
+#include <cassert>
+#include "Blackboard.h"
+#include "Arena.h"
+#include "Random.h"
+#include "BehaviourTree.h"
+
+typedef BehaviourTree BT;
+
+struct Target {
+	int id;
+};
+
+void testBlackboard() {
+	const Blackboard::Key health = Blackboard::key("health");
+	assert(Blackboard::key("health") == health);
+	assert(Blackboard::name(health) == "health");
+
+	Blackboard bb;
+	assert(!bb.has(health) && bb.version(health) == 0);
+	assert(bb.find<int>(health) == nullptr);
+	assert(bb.get<int>(health, 7) == 7);
+
+	bb.set(health, 100);
+	assert(bb.get<int>(health) == 100);
+	assert(bb.find<float>(health) == nullptr);  // wrong type
+	bb.set(health, 90);
+	assert(bb.version(health) == 2);
+	bb.set(health, 0.5f);                        // type change
+	assert(bb.find<int>(health) == nullptr && bb.get<float>(health) == 0.5f);
+	assert(bb.version(health) == 3);
+	bb.erase(health);
+	assert(!bb.has(health) && bb.version(health) == 4);
+	// Versions never go back after an erase.
+	bb.set(health, 1);
+	assert(bb.version(health) == 5);
+}
+
+struct Tracked {
+	explicit Tracked(int& c) : count(c) { ++count; }
+	~Tracked() { --count; }
+	int& count;
+};
+
+void testArena() {
+	Arena arena(64);
+	int live = 0;
+	for (int i = 0; i < 10; i++)
+		arena.create<Tracked>(live);
+	double* d = arena.create<double>(1.5);
+	assert(reinterpret_cast<uintptr_t>(d) % alignof(double) == 0 && *d == 1.5);
+	char* big = static_cast<char*>(arena.allocate(1000));
+	big[999] = 'x';
+	assert(live == 10);
+	arena.reset();
+	assert(live == 0 && arena.used() == 0);
+}
+
+void testRandom() {
+	Random a(42), b(42), c(43);
+	for (int i = 0; i < 100; i++) {
+		const uint64_t x = a();
+		assert(x == b());
+		(void)x;
+	}
+	assert(a() != c());
+	int hits = 0;
+	for (int i = 0; i < 10000; i++) {
+		assert(a.below(10) < 10);
+		const double u = a.uniform();
+		assert(u >= 0.0 && u < 1.0);
+		if (a.chance(0.25)) hits++;
+	}
+	assert(hits > 2000 && hits < 3000);
+	b.jump();
+	assert(a() != b());
+}
+
+// One tree definition ticked for two agents, each with its own variables.
+void testAgents() {
+	BT tree;
+	const Blackboard::Key target = Blackboard::key("target");
+	BT::IsNull<Target> noTarget(target);
+	tree.setRootChild(&noTarget);
+
+	Target t{ 1 };
+	Blackboard first, second;
+	second.set(target, &t);
+	BT::TickContext a(tree.getTimers(), first, 1), b(tree.getTimers(), second, 2);
+	assert(tree.tick(a) == BT::Status::SUCCESS);
+	assert(tree.tick(b) == BT::Status::FAILURE);
+	assert(a.tickId == 1 && b.tickId == 1 && b.agentId == 2);
+	assert(tree.tick() == BT::Status::SUCCESS);  // the tree's own agent
+
+	// Stochastic outcomes only depend on the agent's seed.
+	BT::Probability coin(0.5);
+	tree.setRootChild(&coin);
+	BT::TickContext c(tree.getTimers(), first, 1);
+	for (int i = 0; i < 32; i++)
+		assert(tree.tick(a) == tree.tick(c));
+}
+
+int main()
+{
+	testBlackboard();
+	testArena();
+	testRandom();
+	testAgents();
+	std::cout << "Blackboard tests passed." << std::endl;
+}
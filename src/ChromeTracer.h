@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "BehaviourTree.h"
+
+
+/*
+* A Tracer recording a begin and an end event for every node run, in the
+* Chrome trace event format (chrome://tracing, https://ui.perfetto.dev).
+* Each thread running nodes, Async ones included, appends to its own
+* fixed size buffer without any lock nor allocation; events beyond the
+* capacity of a buffer are dropped and counted. Node names are only
+* looked up when the trace is written.
+*/
+class ChromeTracer : public BehaviourTree::Tracer
+{
+public:
+    typedef BehaviourTree BT;
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Constructor
+     * @param eventsPerThread capacity of each thread's buffer, a node run takes two events
+     */
+    explicit ChromeTracer(const size_t eventsPerThread = 1 << 16) :
+            capacity_(eventsPerThread), serial_(nextSerial()), origin_(Clock::now()) {}
+    ChromeTracer(const ChromeTracer&) = delete;
+    ChromeTracer& operator=(const ChromeTracer&) = delete;
+
+    void enter(const BT::Node& node, const BT::TickContext&) override {
+        record(node, 'B', BT::Status::NOTRUN);
+    }
+    void exit(const BT::Node& node, const BT::TickContext&, const BT::Status status) override {
+        record(node, 'E', status);
+    }
+
+    // Number of events recorded, and dropped for lack of room.
+    size_t events() const { return sum(&Buffer::size); }
+    size_t dropped() const { return sum(&Buffer::dropped); }
+
+    /**
+     * Write the events recorded so far as a JSON trace.
+     * May be called while nodes are still running: their latest events are then left out.
+     */
+    void write(std::ostream& out) const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        std::unordered_map<BT::Node::NameId, std::string> names;
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (const std::unique_ptr<Buffer>& b : buffers_) {
+            const size_t n = b->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; i++) {
+                const Event& e = b->events[i];
+                auto it = names.find(e.name);
+                if (it == names.end())
+                    it = names.emplace(e.name, escape(BT::Node::nameOf(e.name))).first;
+                char ts[32];
+                std::snprintf(ts, sizeof(ts), "%.3f", e.ns / 1000.0);
+                out << (first ? "\n" : ",\n") << "{\"name\":\"" << it->second << "\",\"ph\":\"" << e.phase
+                    << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << b->tid << ",\"args\":{\"node\":\""
+                    << static_cast<const void*>(e.node) << '"';
+                if (e.phase == 'E')
+                    out << ",\"status\":\"" << BT::statusName(e.status) << '"';
+                out << "}}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    // @return false if the file could not be written
+    bool save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        write(file);
+        return static_cast<bool>(file);
+    }
+
+private:
+    struct Event {
+        const BT::Node* node;
+        int64_t ns;                 // since the tracer was made
+        BT::Node::NameId name;
+        BT::Status status;
+        char phase;                 // 'B'egin or 'E'nd
+    };
+
+    // Written by a single thread, read by write() up to the published size.
+    struct Buffer {
+        Buffer(const size_t capacity, const uint32_t t) : events(capacity), tid(t) {}
+        std::vector<Event> events;
+        std::atomic<size_t> size{ 0 };
+        std::atomic<size_t> dropped{ 0 };
+        uint32_t tid;
+    };
+
+    void record(const BT::Node& node, const char phase, const BT::Status status) {
+        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin_).count();
+        Buffer& b = local();
+        const size_t n = b.size.load(std::memory_order_relaxed);
+        if (n == b.events.size()) {
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        b.events[n] = Event{ &node, ns, node.getNameId(), status, phase };
+        b.size.store(n + 1, std::memory_order_release);
+    }
+
+    // The calling thread's buffer. Looked up once per thread and tracer:
+    // the lock is only taken when a thread switches tracers.
+    Buffer& local() {
+        struct Cache {
+            uint64_t tracer = 0;
+            Buffer* buffer = nullptr;
+        };
+        static thread_local Cache cache;
+        if (cache.tracer == serial_)
+            return *cache.buffer;
+
+        std::lock_guard<std::mutex> mlock(mutex_);
+        Buffer*& b = threads_[std::this_thread::get_id()];
+        if (b == nullptr) {
+            buffers_.emplace_back(new Buffer(capacity_, static_cast<uint32_t>(buffers_.size() + 1)));
+            b = buffers_.back().get();
+        }
+        cache.tracer = serial_;
+        cache.buffer = b;
+        return *b;
+    }
+
+    size_t sum(std::atomic<size_t> Buffer::* counter) const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        size_t total = 0;
+        for (const std::unique_ptr<Buffer>& b : buffers_) total += ((*b).*counter).load(std::memory_order_acquire);
+        return total;
+    }
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        for (const char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+                out += hex;
+            }
+            else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    // Tells tracers apart, unlike their addresses which may be reused.
+    static uint64_t nextSerial() {
+        static std::atomic<uint64_t> serial{ 0 };
+        return ++serial;
+    }
+
+    const size_t capacity_;
+    const uint64_t serial_;
+    const Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    std::unordered_map<std::thread::id, Buffer*> threads_;
+};
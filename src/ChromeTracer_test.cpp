@@ -0,0 +1,62 @@
+//
+// Chrome trace events recorded per thread.
+//
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include "ChromeTracer.h"
+
+typedef BehaviourTree BT;
+
+class Counter : public BT::Node {
+public:
+	Counter() : BT::Node("Counter") {}
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override { ++runs; return BT::Status::SUCCESS; }
+};
+
+void testTrace() {
+	BT tree;
+	BT::Sequence sequence;
+	Counter local, remote;
+	BT::Async async(std::chrono::microseconds(1000000));
+	async.setChild(&remote);
+	sequence.setName("Main \"sequence\"");
+	sequence.addChildren({ &local, &async });
+	tree.setRootChild(&sequence);
+
+	ChromeTracer tracer;
+	tree.getContext().tracer = &tracer;
+	assert(tree.tick() == BT::Status::SUCCESS);
+	assert(tracer.events() == 8 && tracer.dropped() == 0);
+
+	std::ostringstream out;
+	tracer.write(out);
+	const std::string json = out.str();
+	assert(json.find("\"name\":\"Main \\\"sequence\\\"\",\"ph\":\"B\"") != std::string::npos);
+	assert(json.find("\"name\":\"Counter\",\"ph\":\"E\"") != std::string::npos);
+	assert(json.find("\"status\":\"SUCCESS\"") != std::string::npos);
+	// The Async child ran on a thread of its own.
+	assert(json.find("\"tid\":1") != std::string::npos && json.find("\"tid\":2") != std::string::npos);
+}
+
+void testOverflow() {
+	BT tree;
+	Counter counter;
+	BT::Repeat repeat(10);
+	repeat.setChild(&counter);
+	tree.setRootChild(&repeat);
+
+	ChromeTracer tracer(4);
+	tree.getContext().tracer = &tracer;
+	tree.tick();
+	assert(tracer.events() == 4 && tracer.dropped() == 18);
+}
+
+int main()
+{
+	testTrace();
+	testOverflow();
+	std::cout << "ChromeTracer tests passed." << std::endl;
+}
@@ -7,17 +7,31 @@
 #include <iostream>
 #include <cstring>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
 
 
 /*
 * Thread safe concurrent Stack with a fixed capacity.
 * It's a LIFO: items are popped out in the inverse order they've been pushed in.
 * The push operations are blocked when the queue is full.
+* Contention is measured all along (see stats()), to tell when the stack
+* becomes a bottleneck. The counters are only written with the lock held, by
+* plain stores next to the mutex: an uncontended operation costs one more
+* store and a try_lock in place of the lock, and a wait two clock reads.
 */
 template <typename T>
 class ConcurrentStack
 {
 public:
+    struct Stats {
+        uint64_t locks;                     // lock acquisitions
+        uint64_t contended;                 // of which had to wait for another thread
+        uint64_t waits;                     // waits for the stack not to be empty or full
+        std::chrono::nanoseconds waited;    // total time spent in these waits
+        size_t peak;                        // largest size reached
+    };
+
     /**
      * Constructor
      * @param capacity if negative, the stack is only limited by the available memory
@@ -28,31 +42,31 @@ public:
             max_size_(capacity), bounded_(capacity > 0), timeout_(ms) {}
 
     ConcurrentStack(const ConcurrentStack& rhs){
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(rhs.mutex_);
         stack_ = rhs.stack_;
         bounded_ = rhs.bounded_;
         max_size_ = rhs.max_size_;
     }
 
     ConcurrentStack<T>& operator=(const ConcurrentStack<T>& rhs) {
-        std::lock_guard<std::mutex> mlock(mutex_);
         if (this == &rhs) return *this;
+        std::unique_lock<std::mutex> mlock(mutex_, std::defer_lock);
+        std::unique_lock<std::mutex> rlock(rhs.mutex_, std::defer_lock);
+        std::lock(mlock, rlock);
 
-        while(!stack_.empty()) { pop(); }
         bounded_ = rhs.bounded_;
         max_size_ = rhs.max_size_;
         stack_ = rhs.stack_;
+        mlock.unlock();
+        queue_empty_.notify_all();
         return *this;
     }
 
     T top() {
-        std::unique_lock<std::mutex> mlock(mutex_);
+        std::unique_lock<std::mutex> mlock = lock();
         while (stack_.empty()){
             std::cout << "Can't read : queue is empty !" << std::endl;
-            if(timeout_ == std::chrono::milliseconds(0))
-                queue_empty_.wait(mlock);
-            else
-                queue_empty_.wait_for(mlock, timeout_);
+            wait(queue_empty_, mlock);
         }
         auto item = stack_.top();
         mlock.unlock();
@@ -60,14 +74,12 @@ public:
         return item;
     }
 
+    // Waits as long as it takes for an item, see try_pop_for() for a deadline.
     T pop(){
-        std::unique_lock<std::mutex> mlock(mutex_);
+        std::unique_lock<std::mutex> mlock = lock();
         while (stack_.empty()) {
             std::cout << "Can't pop : queue is empty !" << std::endl;
-            if(timeout_ == std::chrono::milliseconds(0))
-                queue_empty_.wait(mlock);
-            else
-                queue_empty_.wait_for(mlock, timeout_);
+            wait(queue_empty_, mlock);
         }
         auto item = stack_.top();
         stack_.pop();
@@ -78,37 +90,149 @@ public:
 
     void push(const T&& item) {
         {
-            std::unique_lock<std::mutex> mlock(mutex_);
+            std::unique_lock<std::mutex> mlock = lock();
             while (bounded_ && stack_.size() >= max_size_) {
                 std::cout  << "Can't push : queue is full !\n" << std::endl;
-                queue_full_.wait_for(mlock, timeout_);
+                wait(queue_full_, mlock);
             }
             stack_.emplace(std::move(item));
+            if (stack_.size() > peak_.load(std::memory_order_relaxed))
+                peak_.store(stack_.size(), std::memory_order_relaxed);
+        }
+        queue_empty_.notify_one();
+    }
+
+    /**
+     * Pop, unless the stack stays empty until a deadline.
+     * Unlike pop(), which waits as long as it takes, even when the stack has a timeout.
+     * @return false if nothing was popped
+     */
+    bool try_pop_until(T& item, const std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> mlock = lock();
+        if (!wait_until(queue_empty_, mlock, deadline, [this] { return !stack_.empty(); }))
+            return false;
+        item = stack_.top();
+        stack_.pop();
+        mlock.unlock();
+        queue_full_.notify_one();
+        return true;
+    }
+
+    // A zero delay never waits: the tick threads' way to pop.
+    template <typename Rep, typename Period>
+    bool try_pop_for(T& item, const std::chrono::duration<Rep, Period>& delay) {
+        return try_pop_until(item, std::chrono::steady_clock::now() + delay);
+    }
+
+    /**
+     * Push, unless the stack stays full until a deadline.
+     * @return false if nothing was pushed
+     */
+    bool try_push_until(const T& item, const std::chrono::steady_clock::time_point deadline) {
+        {
+            std::unique_lock<std::mutex> mlock = lock();
+            if (!wait_until(queue_full_, mlock, deadline, [this] { return !bounded_ || stack_.size() < max_size_; }))
+                return false;
+            stack_.push(item);
+            if (stack_.size() > peak_.load(std::memory_order_relaxed))
+                peak_.store(stack_.size(), std::memory_order_relaxed);
         }
         queue_empty_.notify_one();
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    bool try_push_for(const T& item, const std::chrono::duration<Rep, Period>& delay) {
+        return try_push_until(item, std::chrono::steady_clock::now() + delay);
     }
 
     inline size_t size() noexcept{
-        std::lock_guard<std::mutex> mlock(mutex_);
+        std::unique_lock<std::mutex> mlock = lock();
         return stack_.size();
     }
 
     inline bool is_empty() noexcept {
-        std::lock_guard<std::mutex> mlock(mutex_);
+        std::unique_lock<std::mutex> mlock = lock();
         return stack_.empty();
     }
 
     inline bool is_full() noexcept {
-        std::lock_guard<std::mutex> mlock(mutex_);
+        std::unique_lock<std::mutex> mlock = lock();
         return bounded_ && stack_.size() >= max_size_;
     }
 
+    // The contention measured since the stack was made or reset_stats() was called.
+    Stats stats() const {
+        return Stats{ locks_.load(std::memory_order_relaxed), contended_.load(std::memory_order_relaxed),
+                      waits_.load(std::memory_order_relaxed),
+                      std::chrono::nanoseconds(waited_.load(std::memory_order_relaxed)),
+                      peak_.load(std::memory_order_relaxed) };
+    }
+
+    void reset_stats() {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        locks_ = 0;
+        contended_ = 0;
+        waits_ = 0;
+        waited_ = 0;
+        peak_ = stack_.size();
+    }
+
 private:
+    // Lock, counting whether another thread held the lock.
+    std::unique_lock<std::mutex> lock() {
+        std::unique_lock<std::mutex> mlock(mutex_, std::try_to_lock);
+        if (!mlock.owns_lock()) {
+            mlock.lock();
+            count<uint64_t>(contended_, 1);
+        }
+        count<uint64_t>(locks_, 1);
+        return mlock;
+    }
+
+    // Add to a counter, the lock being held: no atomic read-modify-write needed.
+    template <typename N>
+    static void count(std::atomic<N>& counter, const N n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Wait until ready() or the deadline. @return ready()
+    template <typename Predicate>
+    bool wait_until(std::condition_variable& condition, std::unique_lock<std::mutex>& mlock,
+                    const std::chrono::steady_clock::time_point deadline, Predicate ready) {
+        while (!ready()) {
+            const auto start = std::chrono::steady_clock::now();
+            if (start >= deadline) return false;
+            condition.wait_until(mlock, deadline);
+            count<uint64_t>(waits_, 1);
+            count<int64_t>(waited_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+        return true;
+    }
+
+    // Wait for a condition, at most for the stack's timeout if it has one.
+    void wait(std::condition_variable& condition, std::unique_lock<std::mutex>& mlock) {
+        const auto start = std::chrono::steady_clock::now();
+        if (timeout_ == std::chrono::milliseconds(0))
+            condition.wait(mlock);
+        else
+            condition.wait_for(mlock, timeout_);
+        count<uint64_t>(waits_, 1);
+        count<int64_t>(waited_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
     std::stack<T> stack_;
     size_t max_size_;
     bool bounded_;
     std::chrono::milliseconds timeout_{0};
-    std::mutex mutex_{};
+    mutable std::mutex mutex_{};
     std::condition_variable queue_full_{};	// blocks when the stack is full
     std::condition_variable queue_empty_{};	// blocks when the stack is empty
+    std::atomic<uint64_t> locks_{ 0 };
+    std::atomic<uint64_t> contended_{ 0 };
+    std::atomic<uint64_t> waits_{ 0 };
+    std::atomic<int64_t> waited_{ 0 };        // in ns
+    std::atomic<size_t> peak_{ 0 };
 };
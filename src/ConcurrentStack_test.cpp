@@ -4,10 +4,95 @@
 
 #include <iostream>
 #include <cassert>
+#include <thread>
 #include "ConcurrentStack.h"
+#include "BehaviourTree.h"
 
 ConcurrentStack<int> stack(5, std::chrono::milliseconds(500));
 
+void testStats() {
+    ConcurrentStack<int> waiting(1);
+    waiting.push(1);
+    waiting.reset_stats();
+    assert(waiting.stats().locks == 0 && waiting.stats().peak == 1);
+
+    // The push waits until the pop makes room.
+    std::thread producer([&waiting] { waiting.push(2); });
+    while (waiting.stats().locks == 0) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const int popped = waiting.pop();
+    producer.join();
+    assert(popped == 1);
+
+    const ConcurrentStack<int>::Stats stats = waiting.stats();
+    assert(stats.waits >= 1);
+    assert(stats.waited >= std::chrono::milliseconds(5));
+    assert(stats.locks >= 2 && stats.contended <= stats.locks);
+    assert(stats.peak == 1);
+}
+
+void testDeadlines() {
+    ConcurrentStack<int> bounded(1);
+    int item = 0;
+    const auto start = std::chrono::steady_clock::now();
+    const bool poppedEmpty = bounded.try_pop_for(item, std::chrono::milliseconds(20));
+    assert(!poppedEmpty);
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+    const bool poppedNow = bounded.try_pop_for(item, std::chrono::milliseconds(0));
+    assert(!poppedNow);
+
+    const bool pushed = bounded.try_push_for(1, std::chrono::milliseconds(0));
+    const bool pushedFull = bounded.try_push_until(2, std::chrono::steady_clock::now() + std::chrono::milliseconds(5));
+    assert(pushed && !pushedFull);
+    assert(bounded.size() == 1);
+
+    // Woken up before the deadline.
+    int first = 0, second = 0;
+    bool poppedFirst = false, poppedSecond = false;
+    std::thread consumer([&] {
+        poppedFirst = bounded.try_pop_for(first, std::chrono::seconds(10));
+        poppedSecond = bounded.try_pop_for(second, std::chrono::seconds(10));
+    });
+    const bool pushedLater = bounded.try_push_for(2, std::chrono::seconds(10));
+    consumer.join();
+    assert(pushedLater);
+    assert(poppedFirst && first == 1 && poppedSecond && second == 2);
+    assert(bounded.is_empty());
+}
+
+struct Door {
+    int doorNumber;
+};
+
+void testNodes() {
+    typedef BehaviourTree BT;
+    using std::chrono::milliseconds;
+    ConcurrentStack<Door*> doors(1);
+    Door door{ 1 };
+    BT tree;
+    const Blackboard::Key key = Blackboard::key("door");
+    tree.getBlackboard().set(key, &door);
+    const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+
+    // Full: RUNNING instead of blocking, until the patience runs out.
+    BT::Push<Door> push(key, doors, milliseconds(10));
+    tree.setRootChild(&push);
+    assert(tree.tick(t0) == BT::Status::SUCCESS);
+    assert(tree.tick(t0 + milliseconds(1)) == BT::Status::RUNNING);
+    assert(tree.tick(t0 + milliseconds(5)) == BT::Status::RUNNING);
+    assert(tree.tick(t0 + milliseconds(11)) == BT::Status::FAILURE);
+
+    BT::Pop<Door> pop(key, doors);
+    BT::Pop<Door> patientPop(key, doors, milliseconds(10));
+    tree.setRootChild(&pop);
+    assert(tree.tick(t0 + milliseconds(12)) == BT::Status::SUCCESS);
+    assert(tree.tick(t0 + milliseconds(13)) == BT::Status::FAILURE);
+    tree.setRootChild(&patientPop);
+    assert(tree.tick(t0 + milliseconds(14)) == BT::Status::RUNNING);
+    doors.push(&door);
+    assert(tree.tick(t0 + milliseconds(15)) == BT::Status::SUCCESS);
+}
+
 int main()
 {
     //assert(stack.top() == 0);
@@ -24,4 +109,11 @@ int main()
     assert(stack.pop() == 3);
     assert(stack.pop() == 2);
     assert(stack.pop() == 1);
+    assert(stack.stats().peak == 5);
+    assert(stack.stats().waits == 0);
+
+    testStats();
+    testDeadlines();
+    testNodes();
+    std::cout << "ConcurrentStack tests passed." << std::endl;
 }
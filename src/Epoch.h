@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+
+/*
+* Epoch based reclamation.
+* Readers pin the current epoch while they use shared objects; writers retire
+* the objects they unpublish, tagged with the epoch that follows their removal.
+* A retired object is only deleted once no reader is pinned to an older epoch,
+* i.e. once nobody can still hold a pointer to it.
+* Readers claim one of a fixed set of slots with a single compare and swap:
+* no lock is ever taken by readers.
+*/
+class EpochDomain
+{
+private:
+    struct Slot {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> used;
+    };
+
+public:
+    static const size_t MAX_READERS = 256;
+
+    EpochDomain() {
+        for (auto& slot : slots_) {
+            slot.epoch.store(IDLE, std::memory_order_relaxed);
+            slot.used.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    ~EpochDomain() {
+        for (Retired& r : retired_) r.deleter();
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Pins the current epoch for the lifetime of the guard.
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& domain) : slot_(domain.claim()) {
+            slot_.epoch.store(domain.epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        }
+        ~Guard() {
+            slot_.epoch.store(IDLE, std::memory_order_release);
+            slot_.used.store(false, std::memory_order_release);
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    private:
+        Slot& slot_;
+    };
+
+    /**
+     * Hand over an object already unreachable by new readers.
+     * It is deleted by a later collect(), once the readers that may still see it are gone.
+     */
+    template <typename T>
+    void retire(T* object) {
+        const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        std::lock_guard<std::mutex> mlock(mutex_);
+        retired_.push_back(Retired{ epoch, [object] { delete object; } });
+    }
+
+    // Delete what can be. @return the number of objects still waiting.
+    size_t collect() {
+        const uint64_t oldest = oldestPinned();
+        std::vector<Retired> ready;
+        size_t waiting;
+        {
+            std::lock_guard<std::mutex> mlock(mutex_);
+            for (size_t i = 0; i < retired_.size();) {
+                if (retired_[i].epoch <= oldest) {
+                    ready.push_back(std::move(retired_[i]));
+                    retired_[i] = std::move(retired_.back());
+                    retired_.pop_back();
+                }
+                else {
+                    ++i;
+                }
+            }
+            waiting = retired_.size();
+        }
+        for (Retired& r : ready) r.deleter();
+        return waiting;
+    }
+
+private:
+    static const uint64_t IDLE = UINT64_MAX;
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    // A free slot, searched from a per thread starting point so that
+    // the first try nearly always succeeds.
+    Slot& claim() {
+        static thread_local size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS;
+        for (;;) {
+            for (size_t i = 0; i < MAX_READERS; i++) {
+                Slot& s = slots_[(start + i) % MAX_READERS];
+                bool expected = false;
+                if (!s.used.load(std::memory_order_relaxed) &&
+                    s.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    return s;
+            }
+            std::this_thread::yield();    // more concurrent readers than slots
+        }
+    }
+
+    uint64_t oldestPinned() const {
+        uint64_t oldest = epoch_.load(std::memory_order_seq_cst);
+        for (const Slot& s : slots_) {
+            const uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e < oldest) oldest = e;
+        }
+        return oldest;
+    }
+
+    std::atomic<uint64_t> epoch_{ 1 };
+    Slot slots_[MAX_READERS];
+    std::mutex mutex_;
+    std::vector<Retired> retired_;
+};
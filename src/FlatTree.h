@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <initializer_list>
+#include <typeinfo>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "BehaviourTree.h"
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/mman.h>
+#define BT_HAS_JIT 1
+#endif
+
+
+// A leaf calling a plain function, which a FlatTree calls directly rather than through run().
+class FunctionNode : public BehaviourTree::Node {
+public:
+	typedef BehaviourTree::Status (*Function)(void* data, BehaviourTree::TickContext& ctx);
+
+	FunctionNode(const Function f, void* d = nullptr) : function(f), data(d) {}
+	Function getFunction() const { return function; }
+	void* getData() const { return data; }
+private:
+	Function function;
+	void* data;
+	virtual BehaviourTree::Status run(BehaviourTree::TickContext& ctx) override { return function(data, ctx); }
+};
+
+
+/*
+* A tree compiled for ticking fast: the Sequence, Select, Invert, Succeed and
+* Fail nodes are flattened into an array, which is translated to x86-64 code
+* at construction where possible, and interpreted otherwise.
+* The native code is straight branches between the calls of the leaves,
+* short-circuiting as the nodes do, without any dispatch per node.
+* Any other node is a leaf of the compiled tree, ticked as usual with its
+* subtree; FunctionNodes are called directly.
+* The compiled composites keep no memory between ticks: a composite starts
+* over from its first child at every tick, whereas the leaves keep their own
+* state. The nodes must outlive the FlatTree.
+*/
+class FlatTree
+{
+public:
+	typedef BehaviourTree BT;
+
+	/**
+	 * Compile the tree under a node.
+	 * @param native false to always interpret, e.g. to compare both
+	 */
+	explicit FlatTree(BT::Node& root, const bool native = true) {
+		flatten(root);
+#ifdef BT_HAS_JIT
+		if (native) emit();
+#else
+		(void)native;
+#endif
+	}
+	~FlatTree() {
+#ifdef BT_HAS_JIT
+		if (code != nullptr) ::munmap(reinterpret_cast<void*>(code), codeSize);
+#endif
+	}
+	FlatTree(const FlatTree&) = delete;
+	FlatTree& operator=(const FlatTree&) = delete;
+
+	// Run a single pass, for the agent of a context.
+	BT::Status tick(BT::TickContext& ctx) const {
+		if (code != nullptr)
+			return static_cast<BT::Status>(code(&ctx));
+		return interpret(0, ctx);
+	}
+	// A single pass after sampling the clock, like BehaviourTree::tick(root, ctx, now).
+	BT::Status tick(BT::TickContext& ctx, const TimerWheel::Clock::time_point now) const {
+		ctx.now = now;
+		++ctx.tickId;
+		ctx.scratch.reset();
+		ctx.timers.advance(now);
+		return tick(ctx);
+	}
+
+	// Whether the tree runs as native code rather than interpreted.
+	bool isNative() const { return code != nullptr; }
+	// Number of compiled nodes, leaves included.
+	size_t size() const { return ops.size(); }
+
+private:
+	enum class Type : uint8_t { SEQUENCE, SELECT, INVERT, SUCCEED, FAIL, LEAF };
+
+	// A node, followed by its subtree: its children start at the next op.
+	struct Op {
+		Type type;
+		uint32_t end;					// past the subtree
+		FunctionNode::Function function;
+		void* data;
+	};
+
+	static BT::Status tickNode(void* node, BT::TickContext& ctx) {
+		return static_cast<BT::Node*>(node)->tick(ctx);
+	}
+
+	void flatten(BT::Node& node) {
+		const size_t index = ops.size();
+		ops.push_back(Op{ Type::LEAF, 0, &tickNode, &node });
+		const std::type_info& type = typeid(node);
+		if (type == typeid(BT::Sequence) || type == typeid(BT::Select)) {
+			ops[index].type = type == typeid(BT::Sequence) ? Type::SEQUENCE : Type::SELECT;
+			for (BT::Node* child : static_cast<BT::CompositeNode&>(node).getChildren())
+				flatten(*child);
+		}
+		else if ((type == typeid(BT::Invert) || type == typeid(BT::Succeed) || type == typeid(BT::Fail)) &&
+				 static_cast<BT::DecoratorNode&>(node).hasChild()) {
+			ops[index].type = type == typeid(BT::Invert) ? Type::INVERT : type == typeid(BT::Succeed) ? Type::SUCCEED : Type::FAIL;
+			flatten(*static_cast<BT::DecoratorNode&>(node).getChild());
+		}
+		else if (type == typeid(FunctionNode)) {
+			ops[index].function = static_cast<FunctionNode&>(node).getFunction();
+			ops[index].data = static_cast<FunctionNode&>(node).getData();
+		}
+		ops[index].end = static_cast<uint32_t>(ops.size());
+	}
+
+	// The fallback: a walk over the array, with the semantics of the native code.
+	BT::Status interpret(const uint32_t i, BT::TickContext& ctx) const {
+		const Op& op = ops[i];
+		switch (op.type) {
+		case Type::LEAF:
+			return op.function(op.data, ctx);
+		case Type::SEQUENCE: {
+			BT::Status s = BT::Status::SUCCESS;
+			for (uint32_t c = i + 1; c < op.end; c = ops[c].end) {
+				s = interpret(c, ctx);
+				if (s != BT::Status::SUCCESS) return s;
+			}
+			return s;
+		}
+		case Type::SELECT: {
+			bool running = false;
+			for (uint32_t c = i + 1; c < op.end; c = ops[c].end) {
+				const BT::Status s = interpret(c, ctx);
+				if (s == BT::Status::SUCCESS || s == BT::Status::ERROR) return s;
+				if (s == BT::Status::RUNNING) running = true;
+			}
+			return running ? BT::Status::RUNNING : BT::Status::FAILURE;
+		}
+		default: {
+			const BT::Status s = interpret(i + 1, ctx);
+			if (s != BT::Status::SUCCESS && s != BT::Status::FAILURE) return s;
+			if (op.type == Type::INVERT) return s == BT::Status::SUCCESS ? BT::Status::FAILURE : BT::Status::SUCCESS;
+			return op.type == Type::SUCCEED ? BT::Status::SUCCESS : BT::Status::FAILURE;
+		}
+		}
+	}
+
+#ifdef BT_HAS_JIT
+	// System V x86-64: the context stays in rbx, each Select keeps its "a child is RUNNING"
+	// flag in a stack slot of the frame, a node leaves its Status in al.
+	void emit() {
+		bytes({ 0x53, 0x55 });					// push rbx; push rbp
+		bytes({ 0x48, 0x89, 0xE5 });			// mov rbp, rsp
+		bytes({ 0x48, 0x81, 0xEC }); u32(0);	// sub rsp, frame
+		const size_t frameAt = buffer.size();
+		bytes({ 0x48, 0x89, 0xFB });			// mov rbx, rdi
+		node(0, 0);
+		uint32_t frame = 8 * slots;
+		if (frame % 16 == 0) frame += 8;		// rsp 16 byte aligned at the calls
+		for (int k = 0; k < 4; k++) buffer[frameAt - 4 + k] = static_cast<uint8_t>(frame >> (8 * k));
+		bytes({ 0x0F, 0xBE, 0xC0 });			// movsx eax, al
+		bytes({ 0x48, 0x89, 0xEC });			// mov rsp, rbp
+		bytes({ 0x5D, 0x5B, 0xC3 });			// pop rbp; pop rbx; ret
+
+		const size_t page = 4096;
+		codeSize = (buffer.size() + page - 1) / page * page;
+		void* memory = ::mmap(nullptr, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) return;
+		std::memcpy(memory, buffer.data(), buffer.size());
+		if (::mprotect(memory, codeSize, PROT_READ | PROT_EXEC) != 0) {
+			::munmap(memory, codeSize);	// no executable memory: interpreted
+			return;
+		}
+		code = reinterpret_cast<Native>(memory);
+		std::vector<uint8_t>().swap(buffer);
+	}
+
+	// @param selects the number of enclosing Selects, i.e. of slots in use
+	void node(const uint32_t i, const uint32_t selects) {
+		const Op& op = ops[i];
+		switch (op.type) {
+		case Type::LEAF:
+			bytes({ 0x48, 0xBF }); u64(reinterpret_cast<uint64_t>(op.data));		// mov rdi, data
+			bytes({ 0x48, 0x89, 0xDE });											// mov rsi, rbx
+			bytes({ 0x48, 0xB8 }); u64(reinterpret_cast<uint64_t>(op.function));	// mov rax, function
+			bytes({ 0xFF, 0xD0 });													// call rax
+			break;
+		case Type::SEQUENCE: {
+			std::vector<size_t> exits;
+			if (i + 1 == op.end) status(BT::Status::SUCCESS);
+			for (uint32_t c = i + 1; c < op.end; c = ops[c].end) {
+				node(c, selects);
+				if (ops[c].end == op.end) break;
+				compare(BT::Status::SUCCESS);
+				exits.push_back(jump(0x85));	// jne end
+			}
+			for (const size_t at : exits) land(at);
+			break;
+		}
+		case Type::SELECT: {
+			const int32_t slot = -8 * static_cast<int32_t>(selects + 1);
+			slots = std::max(slots, selects + 1);
+			bytes({ 0xC6, 0x85 }); u32(static_cast<uint32_t>(slot)); bytes({ 0 });	// mov byte [rbp+slot], 0
+			std::vector<size_t> exits;
+			for (uint32_t c = i + 1; c < op.end; c = ops[c].end) {
+				node(c, selects + 1);
+				compare(BT::Status::SUCCESS);
+				exits.push_back(jump(0x84));	// je end
+				compare(BT::Status::ERROR);
+				exits.push_back(jump(0x84));	// je end
+				compare(BT::Status::RUNNING);
+				const size_t next = jump(0x85);	// jne next
+				bytes({ 0xC6, 0x85 }); u32(static_cast<uint32_t>(slot)); bytes({ 1 });	// mov byte [rbp+slot], 1
+				land(next);
+			}
+			status(BT::Status::FAILURE);
+			bytes({ 0x80, 0xBD }); u32(static_cast<uint32_t>(slot)); bytes({ 0 });	// cmp byte [rbp+slot], 0
+			exits.push_back(jump(0x84));		// je end
+			status(BT::Status::RUNNING);
+			for (const size_t at : exits) land(at);
+			break;
+		}
+		default: {
+			node(i + 1, selects);
+			// SUCCESS and FAILURE are 1 and 0: anything else is above 1 unsigned, and left alone.
+			compare(BT::Status::SUCCESS);
+			const size_t end = jump(0x87);		// ja end
+			if (op.type == Type::INVERT) bytes({ 0x34, 0x01 });	// xor al, 1
+			else status(op.type == Type::SUCCEED ? BT::Status::SUCCESS : BT::Status::FAILURE);
+			land(end);
+			break;
+		}
+		}
+	}
+
+	void bytes(std::initializer_list<uint8_t> b) { buffer.insert(buffer.end(), b); }
+	void u32(const uint32_t v) { for (int k = 0; k < 4; k++) buffer.push_back(static_cast<uint8_t>(v >> (8 * k))); }
+	void u64(const uint64_t v) { for (int k = 0; k < 8; k++) buffer.push_back(static_cast<uint8_t>(v >> (8 * k))); }
+	void status(const BT::Status s) { bytes({ 0xB0, static_cast<uint8_t>(s) }); }		// mov al, s
+	void compare(const BT::Status s) { bytes({ 0x3C, static_cast<uint8_t>(s) }); }		// cmp al, s
+	// A conditional jump, whose target is set by land(). @return where to patch it
+	size_t jump(const uint8_t condition) {
+		bytes({ 0x0F, condition });
+		u32(0);
+		return buffer.size();
+	}
+	void land(const size_t at) {
+		const uint32_t offset = static_cast<uint32_t>(buffer.size() - at);
+		for (int k = 0; k < 4; k++) buffer[at - 4 + k] = static_cast<uint8_t>(offset >> (8 * k));
+	}
+
+	std::vector<uint8_t> buffer;
+	uint32_t slots = 0;					// the deepest nesting of Selects
+	size_t codeSize = 0;
+#endif
+
+	typedef int (*Native)(BT::TickContext* ctx);
+
+	std::vector<Op> ops;
+	Native code = nullptr;
+};
@@ -0,0 +1,167 @@
+//
+// Trees compiled to native code, against the interpreter and a reference walk.
+//
+
+#include <iostream>
+#include <cassert>
+#include <memory>
+#include <vector>
+#include "FlatTree.h"
+#include "Random.h"
+
+typedef BehaviourTree BT;
+typedef BT::Status Status;
+
+// The leaves return what the test tells them to.
+struct Leaf {
+	Status result = Status::SUCCESS;
+	int calls = 0;
+	static Status call(void* data, BT::TickContext&) {
+		Leaf* leaf = static_cast<Leaf*>(data);
+		++leaf->calls;
+		return leaf->result;
+	}
+};
+
+class Counter : public BT::Node {
+public:
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override { ++runs; return Status::FAILURE; }
+};
+
+// A random tree of compiled nodes over FunctionNode leaves, and its expected Status.
+struct RandomTree {
+	std::vector<std::unique_ptr<BT::Node>> nodes;
+	std::vector<std::unique_ptr<Leaf>> leaves;
+
+	// @param wide only composites of 3 to 5 children above the leaves
+	BT::Node* build(Random& rng, const int depth, const bool wide = false) {
+		const uint32_t kind = depth == 0 ? 5 : wide ? rng.below(2) : rng.below(6);
+		BT::Node* node;
+		if (kind < 2) {
+			BT::CompositeNode* c = kind == 0 ? static_cast<BT::CompositeNode*>(new BT::Sequence) : new BT::Select;
+			nodes.emplace_back(c);
+			const uint32_t n = wide ? 3 + rng.below(3) : rng.below(5);	// possibly none
+			for (uint32_t i = 0; i < n; i++) c->addChild(build(rng, depth - 1, wide));
+			node = c;
+		}
+		else if (kind < 5) {
+			BT::DecoratorNode* d = kind == 2 ? static_cast<BT::DecoratorNode*>(new BT::Invert) :
+				kind == 3 ? static_cast<BT::DecoratorNode*>(new BT::Succeed) : new BT::Fail;
+			nodes.emplace_back(d);
+			d->setChild(build(rng, depth - 1));
+			node = d;
+		}
+		else {
+			leaves.emplace_back(new Leaf);
+			node = new FunctionNode(&Leaf::call, leaves.back().get());
+			nodes.emplace_back(node);
+		}
+		return node;
+	}
+
+	void shuffle(Random& rng) {
+		const Status results[] = { Status::SUCCESS, Status::FAILURE, Status::RUNNING, Status::ERROR };
+		for (std::unique_ptr<Leaf>& leaf : leaves) leaf->result = results[rng.below(4)];
+	}
+
+	// How many times each leaf was called since the last time.
+	std::vector<int> calls() {
+		std::vector<int> n;
+		for (std::unique_ptr<Leaf>& leaf : leaves) {
+			n.push_back(leaf->calls);
+			leaf->calls = 0;
+		}
+		return n;
+	}
+
+	// The semantics of the compiled nodes, walking the original tree.
+	static Status expected(BT::Node* node, BT::TickContext& ctx) {
+		if (BT::Sequence* s = dynamic_cast<BT::Sequence*>(node)) {
+			Status r = Status::SUCCESS;
+			for (BT::Node* c : s->getChildren())
+				if ((r = expected(c, ctx)) != Status::SUCCESS) return r;
+			return r;
+		}
+		if (BT::Select* s = dynamic_cast<BT::Select*>(node)) {
+			bool running = false;
+			for (BT::Node* c : s->getChildren()) {
+				const Status r = expected(c, ctx);
+				if (r == Status::SUCCESS || r == Status::ERROR) return r;
+				running = running || r == Status::RUNNING;
+			}
+			return running ? Status::RUNNING : Status::FAILURE;
+		}
+		if (BT::DecoratorNode* d = dynamic_cast<BT::DecoratorNode*>(node)) {
+			const Status r = expected(d->getChild(), ctx);
+			if (r != Status::SUCCESS && r != Status::FAILURE) return r;
+			if (dynamic_cast<BT::Invert*>(node)) return r == Status::SUCCESS ? Status::FAILURE : Status::SUCCESS;
+			return dynamic_cast<BT::Succeed*>(node) ? Status::SUCCESS : Status::FAILURE;
+		}
+		FunctionNode* f = static_cast<FunctionNode*>(node);
+		return f->getFunction()(f->getData(), ctx);
+	}
+};
+
+void testRandomTrees() {
+	BT tree;
+	Random rng(5);
+	for (int t = 0; t < 200; t++) {
+		RandomTree random;
+		BT::Node* root = random.build(rng, 6);
+		FlatTree native(*root), interpreted(*root, false);
+#ifdef BT_HAS_JIT
+		assert(native.isNative());
+#endif
+		assert(!interpreted.isNative() && native.size() == random.nodes.size());
+		for (int k = 0; k < 10; k++) {
+			random.shuffle(rng);
+			const Status e = RandomTree::expected(root, tree.getContext());
+			const std::vector<int> calls = random.calls();
+			// Short-circuited alike: the same leaves are called as by the reference walk.
+			assert(native.tick(tree.getContext()) == e && random.calls() == calls);
+			assert(interpreted.tick(tree.getContext()) == e && random.calls() == calls);
+		}
+	}
+}
+
+// Other nodes are leaves of the compiled tree, ticked with their subtrees.
+void testPlainNodes() {
+	BT tree;
+	Counter counter;
+	BT::Invert invert;
+	invert.setChild(&counter);
+	BT::Sequence sequence;
+	Leaf leaf;
+	FunctionNode function(&Leaf::call, &leaf);
+	sequence.addChildren({ &invert, &function });
+	FlatTree flat(sequence);
+	assert(flat.size() == 4);
+	assert(flat.tick(tree.getContext(), tree.getTimers().now()) == Status::SUCCESS);
+	assert(counter.runs == 1 && leaf.calls == 1 && tree.getContext().tickId == 1);
+	leaf.result = Status::RUNNING;
+	assert(flat.tick(tree.getContext()) == Status::RUNNING && counter.runs == 2);
+}
+
+// A deep and wide tree, as big as the largest ones.
+void testLargeTree() {
+	BT tree;
+	Random rng(9);
+	RandomTree random;
+	BT::Node* root = random.build(rng, 6, true);
+	assert(random.nodes.size() > 4000);
+	FlatTree native(*root), interpreted(*root, false);
+	for (int k = 0; k < 20; k++) {
+		random.shuffle(rng);
+		const Status e = RandomTree::expected(root, tree.getContext());
+		assert(native.tick(tree.getContext()) == e && interpreted.tick(tree.getContext()) == e);
+	}
+}
+
+int main()
+{
+	testRandomTrees();
+	testPlainNodes();
+	testLargeTree();
+	std::cout << "FlatTree tests passed." << std::endl;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include "BehaviourTree.h"
+#include "NodeRegistry.h"
+#include "Epoch.h"
+
+
+/*
+* A tree whose definition can be replaced while it is being ticked.
+* publish() atomically swaps in a new version: ticks already running finish on
+* the old one, later ticks run the new one, and the old version is reclaimed
+* once the last tick using it is over (epoch based reclamation).
+* State is carried over by stable node id: a node of the new version having
+* the same id and type as a node of the old one (and for composites, the same
+* number of children) adopts its state, including its pending timers.
+* Other nodes start afresh.
+*/
+class HotTree
+{
+public:
+	typedef BehaviourTree BT;
+
+	// @param start origin of the timer wheel, see TimerWheel
+	explicit HotTree(const TimerWheel::Clock::time_point start = TimerWheel::Clock::now()) :
+		timers(std::chrono::milliseconds(1), start) {}
+	~HotTree() {
+		delete current.load();
+	}
+	HotTree(const HotTree&) = delete;
+	HotTree& operator=(const HotTree&) = delete;
+
+	/**
+	 * Make a tree the current version.
+	 * Blocks until no tick runs the previous version, to copy its state. Ticks starting
+	 * meanwhile run the previous version rather than waiting, until one of its ticks is over:
+	 * only ticks overlapping others of the previous version are then held back, until the
+	 * running ones are over and the state is copied.
+	 * This rules out publishing from within a tick of the tree, e.g. from a leaf triggering
+	 * a reload: the tick would wait for itself. Publish from another thread, or between ticks.
+	 * @return the number of the new version, starting from 1, or 0 if called from within
+	 * a tick of the tree or given no node, the tree being left as it was
+	 */
+	uint64_t publish(std::unique_ptr<LoadedTree> tree) {
+		if (!tree || tree->root() == nullptr)
+			return 0;
+		const std::vector<const HotTree*>& trees = ticking();
+		if (std::find(trees.begin(), trees.end(), this) != trees.end())
+			return 0;
+		std::lock_guard<std::mutex> mlock(writer);
+		Version* next = new Version(std::move(tree), ++versions);
+		next->previous = current.load();
+		Version* previous = current.exchange(next);
+		if (previous) {
+			// Wait for a moment no tick runs the previous version, and close it for good
+			// so that its state is final when copied.
+			int idle = 0;
+			while (!previous->readers.compare_exchange_weak(idle, CLOSED)) {
+				idle = 0;
+				std::this_thread::yield();
+			}
+			adoptState(*previous, *next);
+		}
+		next->ready.store(true, std::memory_order_release);
+		if (previous)
+			epochs.retire(previous);
+		epochs.collect();
+		return next->number;
+	}
+
+	// Run a single pass of the current version on behalf of an agent.
+	BT::Status tick(BT::TickContext& ctx) { return tick(ctx, TimerWheel::Clock::now()); }
+	BT::Status tick(BT::TickContext& ctx, const TimerWheel::Clock::time_point now) {
+		Ticking ticked(this);
+		EpochDomain::Guard guard(epochs);
+		Version* v = acquire();
+		if (v == nullptr)
+			return BT::Status::ERROR;
+		const BT::Status s = BT::tick(*v->tree->root(), ctx, now);
+		// Replaced meanwhile: no more ticks falling back to it, lest it never be idle.
+		if (current.load() != v)
+			v->closing.store(true);
+		v->readers.fetch_sub(1);
+		return s;
+	}
+
+	uint64_t version() const {
+		const Version* v = current.load();
+		return v ? v->number : 0;
+	}
+
+	// Delete the old versions no tick uses anymore. @return how many are left.
+	size_t collect() { return epochs.collect(); }
+
+	// Deadlines of the time based nodes, shared by all the versions.
+	TimerWheel& getTimers() { return timers; }
+
+private:
+	struct Version {
+		Version(std::unique_ptr<LoadedTree> t, const uint64_t n) : tree(std::move(t)), number(n) {}
+		std::unique_ptr<LoadedTree> tree;
+		uint64_t number;
+		std::atomic<int> readers{ 0 };			// CLOSED once its state is handed over
+		std::atomic<bool> ready{ false };		// once it has the state of the previous one
+		std::atomic<bool> closing{ false };		// to ticks falling back to it
+		Version* previous = nullptr;			// while not ready
+	};
+	static const int CLOSED = INT_MIN / 2;
+
+	// The trees being ticked by the calling thread, innermost last.
+	static std::vector<const HotTree*>& ticking() {
+		static thread_local std::vector<const HotTree*> trees;
+		return trees;
+	}
+	struct Ticking {
+		explicit Ticking(const HotTree* tree) { ticking().push_back(tree); }
+		~Ticking() { ticking().pop_back(); }
+	};
+
+	// The version to tick, counted as in use by the caller: the current one, or the previous
+	// one while the current one awaits its state. The caller's epoch guard keeps both alive.
+	Version* acquire() {
+		for (;;) {
+			Version* v = current.load();
+			if (v == nullptr)
+				return nullptr;
+			if (!v->ready.load(std::memory_order_acquire)) {
+				Version* p = v->previous;
+				if (p != nullptr && !p->closing.load() && enter(*p))
+					return p;
+				std::this_thread::yield();
+				continue;
+			}
+			v->readers.fetch_add(1);
+			if (current.load() != v) {
+				// Published meanwhile: don't touch a version whose state is being handed over.
+				v->readers.fetch_sub(1);
+				continue;
+			}
+			return v;
+		}
+	}
+
+	// Count a tick in, unless the version is CLOSED.
+	static bool enter(Version& v) {
+		int n = v.readers.load();
+		while (n >= 0) {
+			if (v.readers.compare_exchange_weak(n, n + 1))
+				return true;
+		}
+		return false;
+	}
+
+	static void adoptState(const Version& from, Version& to) {
+		const LoadedTree& old = *from.tree;
+		std::unordered_map<uint32_t, const BT::Node*> byId;
+		for (size_t i = 0; i < old.size(); i++)
+			byId.emplace(old.id(i), old.node(i));
+		for (size_t i = 0; i < to.tree->size(); i++) {
+			auto it = byId.find(to.tree->id(i));
+			BT::Node* node = to.tree->node(i);
+			if (it != byId.end() && sameShape(*it->second, *node))
+				node->adopt(*it->second);
+		}
+	}
+
+	static bool sameShape(const BT::Node& a, const BT::Node& b) {
+		if (typeid(a) != typeid(b)) return false;
+		const BT::CompositeNode* ca = dynamic_cast<const BT::CompositeNode*>(&a);
+		return ca == nullptr || ca->getChildren().size() == static_cast<const BT::CompositeNode&>(b).getChildren().size();
+	}
+
+	std::atomic<Version*> current{ nullptr };
+	uint64_t versions = 0;
+	std::mutex writer;
+	EpochDomain epochs;
+	TimerWheel timers;
+};
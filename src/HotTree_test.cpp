@@ -0,0 +1,176 @@
+//
+// Hot reload: state carried over by node id, old versions reclaimed.
+//
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include "TextTree.h"
+#include "HotTree.h"
+
+typedef BehaviourTree BT;
+using namespace std::chrono;
+
+class Counter : public BT::Node {
+public:
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override { ++runs; return BT::Status::SUCCESS; }
+};
+
+NodeRegistry makeRegistry() {
+	NodeRegistry registry = NodeRegistry::withBuiltins();
+	registry.add<Counter>("Counter");
+	return registry;
+}
+
+const char* const V1 = R"({ "type": "Sequence", "id": 1, "children": [
+	{ "type": "Sleep", "id": 2, "params": { "ms": 10 } },
+	{ "type": "Counter", "id": 3 }
+] })";
+
+// Same ids, one more child: the sequence starts afresh, the sleep keeps its deadline.
+const char* const V2 = R"({ "type": "Sequence", "id": 1, "children": [
+	{ "type": "Sleep", "id": 2, "params": { "ms": 10 } },
+	{ "type": "Counter", "id": 3 },
+	{ "type": "Counter", "id": 4 }
+] })";
+
+std::unique_ptr<LoadedTree> load(const char* json) {
+	std::string error;
+	std::unique_ptr<LoadedTree> tree = TextTree::loadJson(json, makeRegistry(), &error);
+	assert(tree && error.empty());
+	return tree;
+}
+
+void testAdoption() {
+	const auto t0 = TimerWheel::Clock::now();
+	HotTree hot(t0);
+	Blackboard blackboard;
+	BT::TickContext ctx(hot.getTimers(), blackboard);
+	assert(hot.tick(ctx) == BT::Status::ERROR);    // nothing published yet
+
+	assert(hot.publish(load(V1)) == 1);
+	assert(hot.tick(ctx, t0) == BT::Status::RUNNING);
+
+	std::unique_ptr<LoadedTree> v2 = load(V2);
+	LoadedTree& tree = *v2;
+	assert(hot.publish(std::move(v2)) == 2 && hot.version() == 2);
+	assert(hot.tick(ctx, t0 + milliseconds(5)) == BT::Status::RUNNING);
+	// Restarted, the sleep would still have 5ms to go.
+	assert(hot.tick(ctx, t0 + milliseconds(10)) == BT::Status::SUCCESS);
+	assert(static_cast<Counter*>(tree.node(2))->runs == 1);
+	assert(static_cast<Counter*>(tree.node(3))->runs == 1);
+	assert(hot.collect() == 0);
+}
+
+void testConcurrentReload() {
+	HotTree hot;
+	hot.publish(load(V2));
+	std::atomic<bool> done{ false };
+	std::atomic<int> ticks{ 0 };
+	// Node state lives in the nodes: one agent per tree.
+	std::thread agent([&] {
+		Blackboard blackboard;
+		BT::TickContext ctx(hot.getTimers(), blackboard);
+		while (!done.load()) {
+			const BT::Status s = hot.tick(ctx);
+			assert(s == BT::Status::RUNNING || s == BT::Status::SUCCESS);
+			(void)s;
+			++ticks;
+		}
+	});
+	for (int i = 0; i < 200; i++) {
+		hot.publish(load(i % 2 ? V1 : V2));
+		if (i == 0) while (ticks.load() == 0) std::this_thread::yield();
+	}
+	done = true;
+	agent.join();
+	assert(hot.version() == 201);
+	assert(ticks.load() > 0);
+	assert(hot.collect() == 0);
+}
+
+// A leaf reloading the tree it belongs to.
+class Reload : public BT::Node {
+public:
+	explicit Reload(HotTree& h) : hot(h) {}
+	HotTree& hot;
+	uint64_t published = 1;
+	BT::Status run(BT::TickContext&) override {
+		published = hot.publish(load(V1));
+		return BT::Status::SUCCESS;
+	}
+};
+
+void testReloadFromTick() {
+	HotTree hot;
+	Reload reload(hot);
+	NodeRegistry registry = makeRegistry();
+	registry.add("Reload", [&reload](Arena&, const NodeParams&) -> BT::Node* { return &reload; });
+	std::string error;
+	std::unique_ptr<LoadedTree> tree = TextTree::loadJson(R"({ "type": "Reload", "id": 1 })", registry, &error);
+	assert(tree && error.empty());
+	hot.publish(std::move(tree));
+	Blackboard blackboard;
+	BT::TickContext ctx(hot.getTimers(), blackboard);
+	// Rejected rather than waiting for the tick it is called from.
+	assert(hot.tick(ctx) == BT::Status::SUCCESS);
+	assert(reload.published == 0 && hot.version() == 1);
+	assert(hot.publish(load(V1)) == 2);
+}
+
+// Held on its first run until released.
+class Gate : public BT::Node {
+public:
+	std::atomic<bool> entered{ false }, released{ false };
+	std::atomic<int> runs{ 0 };
+	BT::Status run(BT::TickContext&) override {
+		if (runs++ == 0) {
+			entered = true;
+			while (!released.load()) std::this_thread::yield();
+		}
+		return BT::Status::SUCCESS;
+	}
+};
+
+void testHandover() {
+	HotTree hot;
+	Gate gate;
+	NodeRegistry registry = makeRegistry();
+	registry.add("Gate", [&gate](Arena&, const NodeParams&) -> BT::Node* { return &gate; });
+	std::string error;
+	hot.publish(TextTree::loadJson(R"({ "type": "Gate", "id": 1 })", registry, &error));
+	std::thread slow([&] {
+		Blackboard blackboard;
+		BT::TickContext ctx(hot.getTimers(), blackboard);
+		hot.tick(ctx);
+	});
+	while (!gate.entered.load()) std::this_thread::yield();
+	std::atomic<uint64_t> published{ 0 };
+	std::thread publisher([&] { published = hot.publish(load(V1)); });
+	while (hot.version() != 2) std::this_thread::yield();
+	// The new version waits for the slow tick to be over: meanwhile, ticks run the previous one.
+	Blackboard blackboard;
+	BT::TickContext ctx(hot.getTimers(), blackboard);
+	assert(hot.tick(ctx) == BT::Status::SUCCESS && gate.runs == 2);
+	assert(published.load() == 0);
+	gate.released = true;
+	slow.join();
+	publisher.join();
+	assert(published.load() == 2);
+
+	// Nothing to publish.
+	assert(hot.publish(std::unique_ptr<LoadedTree>()) == 0);
+	assert(hot.publish(std::unique_ptr<LoadedTree>(new LoadedTree)) == 0);
+	assert(hot.version() == 2);
+}
+
+int main()
+{
+	testAdoption();
+	testConcurrentReload();
+	testReloadFromTick();
+	testHandover();
+	std::cout << "HotTree tests passed." << std::endl;
+}
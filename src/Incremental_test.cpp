@@ -0,0 +1,198 @@
+//
+// Subtrees ticked again only once the variables they read have changed.
+//
+
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include "BehaviourTree.h"
+#include "TextTree.h"
+#include "TreeCompiler.h"
+
+typedef BehaviourTree BT;
+
+// A condition declaring the variable it reads.
+class Sensor : public BT::Node {
+public:
+	explicit Sensor(const Blackboard::Key k) : key(k) {}
+	Blackboard::Key key;
+	int runs = 0;
+	BT::Status run(BT::TickContext& ctx) override {
+		++runs;
+		return ctx.blackboard.get<int>(key) > 0 ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+	bool reads(std::vector<Blackboard::Key>& keys) const override {
+		keys.push_back(key);
+		return true;
+	}
+};
+
+// The same, without declaring it.
+class Opaque : public BT::Node {
+public:
+	explicit Opaque(const Blackboard::Key k) : key(k) {}
+	Blackboard::Key key;
+	int runs = 0;
+	BT::Status run(BT::TickContext& ctx) override {
+		++runs;
+		return ctx.blackboard.get<int>(key) > 0 ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+};
+
+// RUNNING for a number of ticks, then SUCCESS.
+class Busy : public BT::Node {
+public:
+	explicit Busy(const int t) : ticks(t) {}
+	int ticks;
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override {
+		return ++runs < ticks ? BT::Status::RUNNING : BT::Status::SUCCESS;
+	}
+	bool reads(std::vector<Blackboard::Key>&) const override { return true; }
+};
+
+void testSkipped() {
+	BT tree;
+	const Blackboard::Key enemies = Blackboard::key("enemies"), ammo = Blackboard::key("ammo");
+	Sensor seen(enemies), armed(ammo);
+	BT::Sequence attack;
+	attack.addChildren({ &seen, &armed });
+	BT::Incremental incremental;
+	incremental.setChild(&attack);
+	tree.setRootChild(&incremental);
+
+	tree.getBlackboard().set(enemies, 1);
+	tree.getBlackboard().set(ammo, 0);
+	assert(tree.tick() == BT::Status::FAILURE && seen.runs == 1 && armed.runs == 1);
+	assert(incremental.isTracked());
+	assert((incremental.getWatched() == std::vector<Blackboard::Key>{ std::min(enemies, ammo), std::max(enemies, ammo) }));
+	// Nothing changed: the subtree isn't entered.
+	for (int i = 0; i < 10; i++)
+		assert(tree.tick() == BT::Status::FAILURE);
+	assert(seen.runs == 1 && armed.runs == 1);
+	// Nor does halting the tree drop the cache.
+	incremental.halt(tree.getContext());
+	assert(tree.tick() == BT::Status::FAILURE && seen.runs == 1);
+
+	// A write, even of the same value, evaluates the whole subtree afresh.
+	tree.getBlackboard().set(ammo, 5);
+	assert(tree.tick() == BT::Status::SUCCESS && seen.runs == 2 && armed.runs == 2);
+	assert(tree.tick() == BT::Status::SUCCESS && seen.runs == 2);
+	tree.getBlackboard().set(enemies, 1);
+	assert(tree.tick() == BT::Status::SUCCESS && seen.runs == 3);
+
+	// Another agent doesn't get the first one's Status.
+	Blackboard other;
+	BT::TickContext agent(tree.getTimers(), other, 7);
+	assert(tree.tick(agent) == BT::Status::FAILURE && seen.runs == 4);
+	// Nor does another blackboard under the same id, at the same versions.
+	Blackboard first, second;
+	first.set(enemies, 1);
+	first.set(ammo, 1);
+	second.set(enemies, 0);
+	second.set(ammo, 1);
+	BT::TickContext one(tree.getTimers(), first, 3), two(tree.getTimers(), second, 3);
+	assert(tree.tick(one) == BT::Status::SUCCESS && seen.runs == 5);
+	assert(tree.tick(two) == BT::Status::FAILURE && seen.runs == 6);
+}
+
+void testErased() {
+	BT tree;
+	const Blackboard::Key threat = Blackboard::key("threat");
+	Sensor sensor(threat);
+	BT::Incremental incremental;
+	incremental.setChild(&sensor);
+	tree.setRootChild(&incremental);
+	tree.getBlackboard().set(threat, 1);
+	assert(tree.tick() == BT::Status::SUCCESS && sensor.runs == 1);
+	// Erased and written once more: a change, even if back to the first version number.
+	tree.getBlackboard().erase(threat);
+	tree.getBlackboard().set(threat, 0);
+	assert(tree.tick() == BT::Status::FAILURE && sensor.runs == 2);
+}
+
+void testRunning() {
+	BT tree;
+	Busy busy(3);
+	BT::Incremental incremental;
+	incremental.setChild(&busy);
+	tree.setRootChild(&incremental);
+	// Resumed until done, then kept.
+	assert(tree.tick() == BT::Status::RUNNING);
+	assert(tree.tick() == BT::Status::RUNNING);
+	assert(tree.tick() == BT::Status::SUCCESS && busy.runs == 3);
+	assert(tree.tick() == BT::Status::SUCCESS && busy.runs == 3);
+}
+
+void testUndeclared() {
+	BT tree;
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	Opaque opaque(enemies);
+	BT::Invert invert;
+	invert.setChild(&opaque);
+	BT::Incremental incremental;
+	incremental.setChild(&invert);
+	tree.setRootChild(&incremental);
+	// Anything could change its Status: ticked as usual.
+	assert(tree.tick() == BT::Status::SUCCESS && opaque.runs == 1);
+	assert(!incremental.isTracked());
+	incremental.halt(tree.getContext());
+	assert(tree.tick() == BT::Status::SUCCESS && opaque.runs == 2);
+
+	// Unless its variables are given.
+	BT::Incremental given({ enemies });
+	given.setChild(&invert);
+	tree.setRootChild(&given);
+	assert(tree.tick() == BT::Status::SUCCESS && opaque.runs == 3);
+	assert(tree.tick() == BT::Status::SUCCESS && opaque.runs == 3);
+	tree.getBlackboard().set(enemies, 1);
+	assert(tree.tick() == BT::Status::FAILURE && opaque.runs == 4);
+
+	// Time based nodes depend on more than the blackboard.
+	BT::Cooldown cooldown(std::chrono::milliseconds(10));
+	cooldown.setChild(&opaque);
+	BT::Incremental timed;
+	timed.setChild(&cooldown);
+	tree.setRootChild(&timed);
+	tree.tick();
+	assert(!timed.isTracked());
+}
+
+void testDescriptions() {
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	NodeRegistry registry = NodeRegistry::withBuiltins();
+	int runs = 0;
+	registry.add("Opaque", [&runs](Arena& a, const NodeParams&) -> BT::Node* {
+		struct Counted : Opaque {
+			explicit Counted(int& r) : Opaque(Blackboard::key("enemies")), total(r) {}
+			int& total;
+			BT::Status run(BT::TickContext& ctx) override { ++total; return Opaque::run(ctx); }
+		};
+		return a.create<Counted>(runs);
+	});
+	const char* const json = R"({ "type": "Incremental", "params": { "watch": "enemies" }, "children": [
+		{ "type": "Opaque" }
+	] })";
+	std::string error;
+	std::unique_ptr<LoadedTree> loaded = TextTree::loadJson(json, registry, &error);
+	assert(loaded && error.empty());
+	BT tree;
+	tree.setRootChild(loaded->root());
+	tree.getBlackboard().set(enemies, 1);
+	assert(tree.tick() == BT::Status::SUCCESS && runs == 1);
+	assert(tree.tick() == BT::Status::SUCCESS && runs == 1);
+
+	std::ostringstream header;
+	assert(TreeCompiler::compile(json, "t", header, &error));
+	assert(header.str().find("BT::Incremental builtin0{ std::vector<Blackboard::Key>{ Blackboard::key(\"enemies\") } };") != std::string::npos);
+}
+
+int main()
+{
+	testSkipped();
+	testErased();
+	testRunning();
+	testUndeclared();
+	testDescriptions();
+	std::cout << "Incremental tests passed." << std::endl;
+}
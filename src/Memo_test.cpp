@@ -0,0 +1,197 @@
+//
+// Conditions cached for the rest of a tick.
+//
+
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include "BehaviourTree.h"
+#include "TextTree.h"
+#include "TreeCompiler.h"
+
+typedef BehaviourTree BT;
+
+class Sensor : public BT::Node {
+public:
+	explicit Sensor(const Blackboard::Key k) : key(k) {}
+	Blackboard::Key key;
+	int runs = 0;
+	BT::Status run(BT::TickContext& ctx) override {
+		++runs;
+		return ctx.blackboard.get<int>(key) > 0 ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+};
+
+// The same, declaring the variable it reads.
+class Declared : public Sensor {
+public:
+	explicit Declared(const Blackboard::Key k) : Sensor(k) {}
+	bool reads(std::vector<Blackboard::Key>& keys) const override {
+		keys.push_back(key);
+		return true;
+	}
+};
+
+class Write : public BT::Node {
+public:
+	Write(const Blackboard::Key k, const int v) : key(k), value(v) {}
+	Blackboard::Key key;
+	int value;
+	BT::Status run(BT::TickContext& ctx) override {
+		ctx.blackboard.set(key, value);
+		return BT::Status::SUCCESS;
+	}
+};
+
+void testOncePerTick() {
+	BT tree;
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	Sensor sensor(enemies);
+	BT::Memo memo;
+	memo.setChild(&sensor);
+	// The same condition reached from three branches.
+	BT::Sequence attack, flee;
+	BT::Invert calm;
+	calm.setChild(&memo);
+	attack.addChildren({ &memo, &memo });
+	flee.addChildren({ &calm });
+	BT::Select root;
+	root.addChildren({ &flee, &attack });
+	tree.setRootChild(&root);
+
+	tree.getBlackboard().set(enemies, 1);
+	assert(tree.tick() == BT::Status::SUCCESS && sensor.runs == 1);
+	// The next tick evaluates it again, once the composites start over.
+	root.halt(tree.getContext());
+	assert(tree.tick() == BT::Status::SUCCESS && sensor.runs == 2);
+
+	// Another agent ticked at the same tick id doesn't get the first one's Status.
+	Blackboard other;
+	BT::TickContext agent(tree.getTimers(), other, 7);
+	agent.tickId = tree.getContext().tickId;
+	assert(memo.tick(agent) == BT::Status::FAILURE && sensor.runs == 3);
+	// Nor does another blackboard under the same id.
+	Blackboard third;
+	third.set(enemies, 1);
+	BT::TickContext same(tree.getTimers(), third, 7);
+	same.tickId = agent.tickId;
+	assert(memo.tick(same) == BT::Status::SUCCESS && sensor.runs == 4);
+}
+
+void testWatched() {
+	BT tree;
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	Sensor sensor(enemies);
+	BT::Memo memo({ enemies });
+	memo.setChild(&sensor);
+	Write clear(enemies, 0);
+	BT::Sequence sequence;
+	BT::Invert gone;
+	gone.setChild(&memo);
+	sequence.addChildren({ &memo, &clear, &gone });
+	tree.setRootChild(&sequence);
+
+	tree.getBlackboard().set(enemies, 3);
+	// Written between the two passes: evaluated again, and now false.
+	assert(tree.tick() == BT::Status::SUCCESS && sensor.runs == 2);
+
+	// Without variables given, a memo watches those its subtree declares.
+	Declared declared(enemies);
+	BT::Memo gathered;
+	gathered.setChild(&declared);
+	Write cleared(enemies, 0);
+	BT::Invert left;
+	left.setChild(&gathered);
+	BT::Sequence declaring;
+	declaring.addChildren({ &gathered, &cleared, &left });
+	tree.getBlackboard().set(enemies, 3);
+	tree.setRootChild(&declaring);
+	assert(tree.tick() == BT::Status::SUCCESS && declared.runs == 2);
+	assert(gathered.getWatched() == std::vector<Blackboard::Key>{ enemies });
+
+	// Such as a built-in condition.
+	BT::IsNull<int> none(enemies);
+	BT::Memo checked;
+	checked.setChild(&none);
+	tree.setRootChild(&checked);
+	tree.tick();
+	assert(checked.getWatched() == std::vector<Blackboard::Key>{ enemies });
+
+	// A memo whose subtree doesn't declare its variables keeps its Status for the whole tick.
+	BT::Memo blind;
+	blind.setChild(&sensor);
+	gone.setChild(&blind);
+	BT::Sequence again;
+	again.addChildren({ &blind, &clear, &gone });
+	tree.getBlackboard().set(enemies, 3);
+	tree.setRootChild(&again);
+	assert(tree.tick() == BT::Status::FAILURE && sensor.runs == 3);
+	assert(blind.getWatched().empty());
+}
+
+// Erase a variable, then write it again.
+class Reset : public BT::Node {
+public:
+	Reset(const Blackboard::Key k, const int v) : key(k), value(v) {}
+	Blackboard::Key key;
+	int value;
+	BT::Status run(BT::TickContext& ctx) override {
+		ctx.blackboard.erase(key);
+		ctx.blackboard.set(key, value);
+		return BT::Status::SUCCESS;
+	}
+};
+
+void testErased() {
+	BT tree;
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	Sensor sensor(enemies);
+	BT::Memo memo({ enemies });
+	memo.setChild(&sensor);
+	Reset reset(enemies, 0);
+	BT::Invert gone;
+	gone.setChild(&memo);
+	BT::Sequence sequence;
+	sequence.addChildren({ &memo, &reset, &gone });
+	tree.setRootChild(&sequence);
+	// Erased and written once more: a change, even if back to the first version number.
+	tree.getBlackboard().set(enemies, 3);
+	assert(tree.tick() == BT::Status::SUCCESS && sensor.runs == 2);
+}
+
+void testDescriptions() {
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	NodeRegistry registry = NodeRegistry::withBuiltins();
+	int runs = 0;
+	registry.add("Sensor", [&runs](Arena& a, const NodeParams&) -> BT::Node* {
+		struct Counted : Sensor {
+			explicit Counted(int& r) : Sensor(Blackboard::key("enemies")), total(r) {}
+			int& total;
+			BT::Status run(BT::TickContext& ctx) override { ++total; return Sensor::run(ctx); }
+		};
+		return a.create<Counted>(runs);
+	});
+	const char* const json = R"({ "type": "Sequence", "children": [
+		{ "type": "Memo", "params": { "watch": "enemies, target" }, "children": [ { "type": "Sensor" } ] }
+	] })";
+	std::string error;
+	std::unique_ptr<LoadedTree> loaded = TextTree::loadJson(json, registry, &error);
+	assert(loaded && error.empty());
+	BT tree;
+	tree.setRootChild(loaded->root());
+	tree.getBlackboard().set(enemies, 1);
+	assert(tree.tick() == BT::Status::SUCCESS && runs == 1);
+
+	std::ostringstream header;
+	assert(TreeCompiler::compile(json, "t", header, &error));
+	assert(header.str().find("BT::Memo builtin1{ std::vector<Blackboard::Key>{ Blackboard::key(\"enemies\"), Blackboard::key(\"target\") } };") != std::string::npos);
+}
+
+int main()
+{
+	testOncePerTick();
+	testWatched();
+	testErased();
+	testDescriptions();
+	std::cout << "Memo tests passed." << std::endl;
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BehaviourTree.h"
+#include "ConcurrentStack.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define BT_HAS_SOCKETS 1
+#endif
+
+
+/*
+* Registry of aggregate metrics, exported in the Prometheus text format.
+* Counters are sharded over cache lines: each thread adds to its own shard
+* without contention, and the shards are only summed when scraped.
+* Gauges are either maintained the same way or sampled by a function at
+* scrape time.
+*/
+class Metrics
+{
+public:
+    // A sum split over shards, so that threads rarely write the same cache line.
+    class Counter {
+    public:
+        void add(const int64_t n = 1) { cells_[shard()].value.fetch_add(n, std::memory_order_relaxed); }
+        int64_t value() const {
+            int64_t total = 0;
+            for (const Cell& c : cells_) total += c.value.load(std::memory_order_relaxed);
+            return total;
+        }
+        void reset() { for (Cell& c : cells_) c.value.store(0, std::memory_order_relaxed); }
+    private:
+        static const size_t SHARDS = 16;
+        struct Cell {
+            std::atomic<int64_t> value{ 0 };
+            char pad[64 - sizeof(std::atomic<int64_t>)];
+        };
+        static size_t shard() {
+            static thread_local const size_t s = std::hash<std::thread::id>()(std::this_thread::get_id()) % SHARDS;
+            return s;
+        }
+        Cell cells_[SHARDS];
+    };
+
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    /**
+     * A monotonic counter. Asking twice for the same name and labels gives the same counter.
+     * @param labels Prometheus labels without the braces, e.g. tree="doors"
+     */
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return series(name, help, "counter", labels).counter;
+    }
+
+    // A value that goes up and down.
+    Counter& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return series(name, help, "gauge", labels).counter;
+    }
+
+    // A gauge read from a function at each scrape, e.g. the size of a queue.
+    void gauge(const std::string& name, const std::string& help, const std::string& labels,
+               std::function<double()> sample) {
+        series(name, help, "gauge", labels).sample = std::move(sample);
+    }
+
+    // A counter kept elsewhere, read at each scrape.
+    void counter(const std::string& name, const std::string& help, const std::string& labels,
+                 std::function<double()> sample) {
+        series(name, help, "counter", labels).sample = std::move(sample);
+    }
+
+    // The current values, in the Prometheus text exposition format.
+    std::string scrape() const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        std::ostringstream out;
+        for (const std::unique_ptr<Family>& f : families_) {
+            out << "# HELP " << f->name << ' ' << f->help << '\n';
+            out << "# TYPE " << f->name << ' ' << f->type << '\n';
+            for (const std::unique_ptr<Series>& s : f->series) {
+                out << f->name;
+                if (!s->labels.empty()) out << '{' << s->labels << '}';
+                if (s->sample) out << ' ' << s->sample() << '\n';
+                else out << ' ' << s->counter.value() << '\n';
+            }
+        }
+        return out.str();
+    }
+
+    /**
+     * Write the metrics to a file, e.g. for node_exporter's textfile collector.
+     * The file is replaced at once, never seen half written.
+     * @return false if it could not be written
+     */
+    bool save(const std::string& path) const {
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file << scrape();
+            if (!file) return false;
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // A label value, with the characters Prometheus wants escaped.
+    static std::string label(const std::string& name, const std::string& value) {
+        std::string out = name + "=\"";
+        for (const char c : value) {
+            if (c == '\\' || c == '"') { out += '\\'; out += c; }
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        return out + '"';
+    }
+
+private:
+    struct Series {
+        std::string labels;
+        Counter counter;
+        std::function<double()> sample;
+    };
+    struct Family {
+        std::string name, help, type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    Series& series(const std::string& name, const std::string& help, const char* type, const std::string& labels) {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        Family* family = nullptr;
+        for (const std::unique_ptr<Family>& f : families_)
+            if (f->name == name) family = f.get();
+        if (family == nullptr) {
+            families_.emplace_back(new Family{ name, help, type, {} });
+            family = families_.back().get();
+        }
+        for (const std::unique_ptr<Series>& s : family->series)
+            if (s->labels == labels) return *s;
+        family->series.emplace_back(new Series());
+        family->series.back()->labels = labels;
+        return *family->series.back();
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Family>> families_;
+};
+
+
+/*
+* Export the contention counters of a ConcurrentStack, labelled stack="name".
+* The stack must outlive the metrics.
+*/
+template <typename T>
+void exportStack(Metrics& metrics, const std::string& name, const ConcurrentStack<T>& stack) {
+    typedef typename ConcurrentStack<T>::Stats Stats;
+    const std::string labels = Metrics::label("stack", name);
+    const ConcurrentStack<T>* s = &stack;
+    metrics.counter("bt_stack_locks_total", "Lock acquisitions of the stack.", labels,
+                    [s] { return static_cast<double>(s->stats().locks); });
+    metrics.counter("bt_stack_contended_total", "Lock acquisitions that had to wait for another thread.", labels,
+                    [s] { return static_cast<double>(s->stats().contended); });
+    metrics.counter("bt_stack_waits_total", "Waits for the stack not to be empty or full.", labels,
+                    [s] { return static_cast<double>(s->stats().waits); });
+    metrics.counter("bt_stack_wait_seconds_total", "Time spent waiting for the stack not to be empty or full.", labels,
+                    [s] { const Stats st = s->stats(); return std::chrono::duration<double>(st.waited).count(); });
+    metrics.gauge("bt_stack_peak_size", "Largest size reached by the stack.", labels,
+                  [s] { return static_cast<double>(s->stats().peak); });
+}
+
+
+/*
+* A Tracer counting the ticks of a tree, and the runs and RUNNING nodes of the
+* node types asked for (e.g. "Async", whose RUNNING count is the number of
+* asynchronous jobs in flight). Node types are node names, as set by the NodeRegistry.
+*/
+class TreeMetrics : public BehaviourTree::Tracer
+{
+public:
+    typedef BehaviourTree BT;
+
+    /**
+     * Constructor
+     * @param tree the tree label of the series
+     * @param top the node ticked first at each pass, i.e. the child of the tree's root
+     * @param types the node types to be counted
+     */
+    TreeMetrics(Metrics& metrics, const std::string& tree, const BT::Node& top,
+                std::initializer_list<std::string> types = {}) :
+            top_(top),
+            ticks_(metrics.counter("bt_ticks_total", "Passes through the tree.", Metrics::label("tree", tree))),
+            running_(metrics.gauge("bt_running_nodes", "Nodes whose latest tick returned RUNNING.",
+                                   Metrics::label("tree", tree))) {
+        for (const std::string& type : types) {
+            const BT::Node::NameId id = BT::Node::intern(type);
+            if (id >= types_.size()) types_.resize(id + 1);
+            const std::string labels = Metrics::label("tree", tree) + ',' + Metrics::label("type", type);
+            types_[id].runs = &metrics.counter("bt_node_runs_total", "Node runs, by node type.", labels);
+            types_[id].running = &metrics.gauge("bt_running_nodes_by_type", "Nodes whose latest tick returned RUNNING, by node type.", labels);
+        }
+    }
+
+    void enter(const BT::Node&, const BT::TickContext&) override {}
+    void exit(const BT::Node& node, const BT::TickContext&, const BT::Status status) override {
+        if (&node == &top_) ticks_.add();
+        const int64_t delta = (status == BT::Status::RUNNING) - (node.getTickStatus() == BT::Status::RUNNING);
+        if (delta != 0) running_.add(delta);
+        const BT::Node::NameId type = node.getNameId();
+        if (type < types_.size() && types_[type].runs != nullptr) {
+            types_[type].runs->add();
+            if (delta != 0) types_[type].running->add(delta);
+        }
+    }
+
+private:
+    struct Type {
+        Metrics::Counter* runs = nullptr;
+        Metrics::Counter* running = nullptr;
+    };
+
+    const BT::Node& top_;
+    Metrics::Counter& ticks_;
+    Metrics::Counter& running_;
+    std::vector<Type> types_;       // indexed by node name id
+};
+
+
+#ifdef BT_HAS_SOCKETS
+/*
+* Serves the metrics to Prometheus over HTTP, on the loopback interface only,
+* from a thread of its own.
+*/
+class MetricsServer
+{
+public:
+    explicit MetricsServer(const Metrics& metrics) : metrics_(metrics) {}
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    ~MetricsServer() { stop(); }
+
+    /**
+     * Start serving on 127.0.0.1.
+     * @param port 0 for any free port, see port()
+     * @return false on failure, described in error if given, or if already listening
+     */
+    bool listen(const uint16_t port, std::string* error = nullptr) {
+        if (thread_.joinable()) return fail(error, "already listening on port " + std::to_string(port_));
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) return fail(error, "can't create socket");
+        const int yes = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        socklen_t len = sizeof(addr);
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 8) != 0 ||
+            ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return fail(error, "can't listen on port " + std::to_string(port));
+        }
+        port_ = ntohs(addr.sin_port);
+        stopping_ = false;
+        thread_ = std::thread([this] { serve(); });
+        return true;
+    }
+
+    void stop() {
+        stopping_ = true;
+        if (thread_.joinable()) thread_.join();
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    uint16_t port() const { return port_; }
+
+private:
+#ifdef MSG_NOSIGNAL
+    static const int NO_SIGPIPE = MSG_NOSIGNAL;     // a client hanging up mustn't kill the process
+#else
+    static const int NO_SIGPIPE = 0;
+#endif
+
+    static bool fail(std::string* error, const std::string& msg) {
+        if (error) *error = msg;
+        return false;
+    }
+
+    void serve() {
+        while (!stopping_) {
+            pollfd p = { fd_, POLLIN, 0 };
+            if (::poll(&p, 1, 100) <= 0) continue;
+            const int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0) continue;
+            // A client that sends nothing is dropped, rather than holding up stop().
+            if (!readable(client)) {
+                ::close(client);
+                continue;
+            }
+            char request[1024];
+            ::recv(client, request, sizeof(request), 0);    // whatever the path, the metrics
+            const std::string body = metrics_.scrape();
+            const std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                         "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            size_t sent = 0;
+            while (sent < response.size()) {
+                const ssize_t n = ::send(client, response.data() + sent, response.size() - sent, NO_SIGPIPE);
+                if (n <= 0) break;
+                sent += static_cast<size_t>(n);
+            }
+            ::close(client);
+        }
+    }
+
+    // Wait for a request, at most a second, and no longer than stop() is called.
+    bool readable(const int client) const {
+        for (int waited = 0; waited < 1000 && !stopping_; waited += 100) {
+            pollfd p = { client, POLLIN, 0 };
+            if (::poll(&p, 1, 100) > 0) return true;
+        }
+        return false;
+    }
+
+    const Metrics& metrics_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{ false };
+    std::thread thread_;
+};
+#endif
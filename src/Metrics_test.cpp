@@ -0,0 +1,132 @@
+//
+// Metrics registry, tree metrics and their Prometheus export.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+
+typedef BehaviourTree BT;
+using std::chrono::milliseconds;
+
+bool contains(const std::string& text, const std::string& part) {
+	return text.find(part) != std::string::npos;
+}
+
+void testRegistry() {
+	Metrics metrics;
+	Metrics::Counter& jobs = metrics.counter("jobs_total", "Jobs done.", Metrics::label("queue", "a\"b"));
+	assert(&jobs == &metrics.counter("jobs_total", "Jobs done.", Metrics::label("queue", "a\"b")));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+		threads.emplace_back([&jobs] { for (int i = 0; i < 1000; i++) jobs.add(); });
+	for (std::thread& t : threads) t.join();
+	assert(jobs.value() == 4000);
+
+	metrics.gauge("depth", "Queue depth.", "", [] { return 2.5; });
+	const std::string text = metrics.scrape();
+	assert(contains(text, "# HELP jobs_total Jobs done.\n# TYPE jobs_total counter\n"));
+	assert(contains(text, "jobs_total{queue=\"a\\\"b\"} 4000\n"));
+	assert(contains(text, "# TYPE depth gauge\ndepth 2.5\n"));
+
+	const std::string path = "Metrics_test.prom";
+	const bool written = metrics.save(path);
+	assert(written);
+	std::ifstream file(path);
+	std::stringstream saved;
+	saved << file.rdbuf();
+	std::remove(path.c_str());
+	assert(saved.str() == text);
+}
+
+void testTreeMetrics() {
+	BT tree;
+	BT::Sleep sleep(milliseconds(5));
+	sleep.setName("Sleep");
+	BT::Sequence sequence;
+	sequence.addChildren({ &sleep });
+	tree.setRootChild(&sequence);
+
+	Metrics metrics;
+	TreeMetrics tracer(metrics, "doors", sequence, { "Sleep" });
+	tree.getContext().tracer = &tracer;
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+	tree.tick(t0);
+	tree.tick(t0 + milliseconds(1));
+	std::string text = metrics.scrape();
+	assert(contains(text, "bt_ticks_total{tree=\"doors\"} 2\n"));
+	assert(contains(text, "bt_running_nodes{tree=\"doors\"} 2\n"));
+	assert(contains(text, "bt_node_runs_total{tree=\"doors\",type=\"Sleep\"} 2\n"));
+	assert(contains(text, "bt_running_nodes_by_type{tree=\"doors\",type=\"Sleep\"} 1\n"));
+
+	tree.tick(t0 + milliseconds(5));
+	text = metrics.scrape();
+	assert(contains(text, "bt_ticks_total{tree=\"doors\"} 3\n"));
+	assert(contains(text, "bt_running_nodes{tree=\"doors\"} 0\n"));
+}
+
+void testStack() {
+	Metrics metrics;
+	ConcurrentStack<int> stack(4);
+	exportStack(metrics, "doors", stack);
+	stack.push(1);
+	stack.push(2);
+	const std::string text = metrics.scrape();
+	assert(contains(text, "# TYPE bt_stack_locks_total counter\nbt_stack_locks_total{stack=\"doors\"} 2\n"));
+	assert(contains(text, "bt_stack_waits_total{stack=\"doors\"} 0\n"));
+	assert(contains(text, "bt_stack_peak_size{stack=\"doors\"} 2\n"));
+}
+
+void testServer() {
+#ifdef BT_HAS_SOCKETS
+	Metrics metrics;
+	metrics.counter("up_total", "Up.").add(7);
+	MetricsServer server(metrics);
+	std::string error;
+	if (!server.listen(0, &error)) {
+		std::cout << "Skipping the HTTP test: " << error << std::endl;
+		return;
+	}
+	const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr = sockaddr_in();
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(server.port());
+	assert(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+	const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+	assert(::send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+	std::string response;
+	char buffer[512];
+	ssize_t n;
+	while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, n);
+	::close(fd);
+	assert(contains(response, "HTTP/1.0 200 OK\r\n"));
+	assert(contains(response, "\r\n\r\n# HELP up_total Up.\n# TYPE up_total counter\nup_total 7\n"));
+
+	const bool again = server.listen(0, &error);
+	assert(!again && !error.empty());
+	// A client that never sends its request doesn't hold up stop().
+	const int idle = ::socket(AF_INET, SOCK_STREAM, 0);
+	const bool connected = ::connect(idle, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+	assert(connected);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	const auto start = std::chrono::steady_clock::now();
+	server.stop();
+	assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+	::close(idle);
+#endif
+}
+
+int main()
+{
+	testRegistry();
+	testTreeMetrics();
+	testStack();
+	testServer();
+	std::cout << "Metrics tests passed." << std::endl;
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include "BehaviourTree.h"
+#include "Random.h"
+
+
+/*
+* Concurrent priority queue, relaxed: a multi-queue (Rihani, Sanders and
+* Dementiev) made of several heaps, each with its own lock.
+* Items are pushed to a random heap; popping compares the best items of two
+* random heaps and takes the better one. Threads thus rarely meet on a lock,
+* at the price of popping an item that is only among the best ones, not
+* always the very best. Higher priorities come out first.
+*/
+template <typename T>
+class MultiQueue
+{
+public:
+	/**
+	 * Constructor
+	 * @param queues number of heaps, twice the hardware concurrency by default
+	 */
+	explicit MultiQueue(const size_t queues = 0) :
+		count_(queues ? queues : 2 * std::max(1u, std::thread::hardware_concurrency())),
+		heaps_(new Heap[count_]) {}
+	MultiQueue(const MultiQueue&) = delete;
+	MultiQueue& operator=(const MultiQueue&) = delete;
+
+	/**
+	 * Push an item to a random heap, trying as many heaps as there are before
+	 * waiting for the lock of the last one tried.
+	 * @return false if the priority is NaN, which can't be ordered, or -infinity,
+	 * which marks the empty heaps
+	 */
+	bool push(const T& item, const double priority) {
+		if (std::isnan(priority) || priority == EMPTY) return false;
+		Random& rng = Random::local();
+		for (size_t tries = 1; ; tries++) {
+			Heap& h = heaps_[rng.below(static_cast<uint32_t>(count_))];
+			std::unique_lock<std::mutex> mlock(h.mutex, std::defer_lock);
+			if (tries < count_) {
+				if (!mlock.try_lock()) continue;    // another heap will do
+			}
+			else {
+				mlock.lock();                       // all busy: wait rather than spin
+			}
+			h.push(Entry{ priority, item });
+			size_.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	/**
+	 * Pop one of the items of highest priority.
+	 * @param priority if given, receives the priority of the item
+	 * @return false if the queue was empty
+	 */
+	bool try_pop(T& item, double* priority = nullptr) {
+		Random& rng = Random::local();
+		while (size_.load(std::memory_order_relaxed) > 0) {
+			size_t a = rng.below(static_cast<uint32_t>(count_));
+			size_t b = rng.below(static_cast<uint32_t>(count_));
+			if (heaps_[b].best() > heaps_[a].best()) a = b;
+			if (heaps_[a].best() == EMPTY) {
+				// Both look empty: the items may all be elsewhere.
+				bool contended = false;
+				if (popAny(item, priority, contended)) return true;
+				if (!contended) return false;
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> mlock(heaps_[a].mutex, std::try_to_lock);
+			if (!mlock.owns_lock() || heaps_[a].entries.empty()) continue;
+			pop(heaps_[a], item, priority);
+			return true;
+		}
+		return false;
+	}
+
+	// Approximate while other threads push or pop.
+	size_t size() const { return size_.load(std::memory_order_relaxed); }
+	bool is_empty() const { return size() == 0; }
+
+private:
+	struct Entry {
+		double priority;
+		T item;
+		bool operator<(const Entry& rhs) const { return priority < rhs.priority; }
+	};
+
+	static constexpr double EMPTY = -std::numeric_limits<double>::infinity();
+
+	// A max heap, whose best priority can be read without taking the lock.
+	struct Heap {
+		std::mutex mutex;
+		std::vector<Entry> entries;
+		std::atomic<double> top{ EMPTY };
+		char pad[64];
+
+		double best() const { return top.load(std::memory_order_relaxed); }
+		void push(const Entry& e) {
+			entries.push_back(e);
+			std::push_heap(entries.begin(), entries.end());
+			top.store(entries.front().priority, std::memory_order_relaxed);
+		}
+		Entry pop() {
+			std::pop_heap(entries.begin(), entries.end());
+			const Entry e = entries.back();
+			entries.pop_back();
+			top.store(entries.empty() ? EMPTY : entries.front().priority, std::memory_order_relaxed);
+			return e;
+		}
+	};
+
+	void pop(Heap& h, T& item, double* priority) {
+		const Entry e = h.pop();
+		size_.fetch_sub(1, std::memory_order_relaxed);
+		item = e.item;
+		if (priority) *priority = e.priority;
+	}
+
+	// Scan every heap from a random one: the slow path of a nearly empty queue.
+	// Heaps locked by other threads are skipped rather than waited for, and reported
+	// through contended, so that poppers don't queue up on the same locks.
+	bool popAny(T& item, double* priority, bool& contended) {
+		const size_t first = Random::local().below(static_cast<uint32_t>(count_));
+		for (size_t n = 0; n < count_; n++) {
+			Heap& h = heaps_[(first + n) % count_];
+			std::unique_lock<std::mutex> mlock(h.mutex, std::try_to_lock);
+			if (!mlock.owns_lock()) {
+				contended = true;
+				continue;
+			}
+			if (!h.entries.empty()) {
+				pop(h, item, priority);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const size_t count_;
+	std::unique_ptr<Heap[]> heaps_;
+	std::atomic<size_t> size_{ 0 };
+};
+
+template <typename T>
+constexpr double MultiQueue<T>::EMPTY;
+
+
+// Push a blackboard variable to a MultiQueue, with the priority held by another variable.
+template <typename T>
+class PushPrio : public BehaviourTree::Node {
+public:
+	PushPrio(const Blackboard::Key t, const Blackboard::Key p, MultiQueue<T*>& q) : queue(q), item(t), priority(p) {}
+private:
+	MultiQueue<T*>& queue;
+	Blackboard::Key item, priority;
+	virtual BehaviourTree::Status run(BehaviourTree::TickContext& ctx) override {
+		T** object = ctx.blackboard.find<T*>(item);
+		const double* value = ctx.blackboard.find<double>(priority);
+		if (object == nullptr || value == nullptr || !queue.push(*object, *value))
+			return BehaviourTree::Status::ERROR;
+		return BehaviourTree::Status::SUCCESS;
+	}
+};
+
+// Pop one of the items of highest priority into a blackboard variable, FAILURE if there is none.
+template <typename T>
+class PopBest : public BehaviourTree::Node {
+public:
+	PopBest(const Blackboard::Key t, MultiQueue<T*>& q) : queue(q), item(t) {}
+private:
+	MultiQueue<T*>& queue;
+	Blackboard::Key item;
+	virtual BehaviourTree::Status run(BehaviourTree::TickContext& ctx) override {
+		T* object;
+		if (!queue.try_pop(object))
+			return BehaviourTree::Status::FAILURE;
+		ctx.blackboard.set(item, object);
+		return BehaviourTree::Status::SUCCESS;
+	}
+};
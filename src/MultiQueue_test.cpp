@@ -0,0 +1,111 @@
+//
+// Relaxed concurrent priority queue and its nodes.
+//
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "MultiQueue.h"
+
+typedef BehaviourTree BT;
+
+void testOrder() {
+	// A single heap is an exact priority queue.
+	MultiQueue<int> exact(1);
+	const double priorities[] = { 3, 9, 1, 7, 5 };
+	for (int i = 0; i < 5; i++) exact.push(i, priorities[i]);
+	int item;
+	double priority;
+	assert(exact.try_pop(item, &priority) && item == 1 && priority == 9);
+	assert(exact.try_pop(item) && item == 3);
+	assert(exact.try_pop(item) && item == 4);
+	assert(exact.try_pop(item) && item == 0);
+	assert(exact.try_pop(item) && item == 2);
+	assert(!exact.try_pop(item) && exact.is_empty());
+
+	// Relaxed: the items popped first are among the best ones.
+	MultiQueue<int> relaxed(8);
+	for (int i = 0; i < 10000; i++) relaxed.push(i, i);
+	long long rank = 0;
+	for (int n = 0; n < 100; n++) {
+		assert(relaxed.try_pop(item));
+		rank += 9999 - item;
+	}
+	assert(rank / 100 < 500);
+	int count = 100;
+	while (relaxed.try_pop(item)) ++count;
+	assert(count == 10000);
+}
+
+void testConcurrent() {
+	const int threads = 4, perThread = 20000;
+	MultiQueue<int> queue(8);
+	std::vector<std::atomic<int>> seen(threads * perThread);
+	for (std::atomic<int>& s : seen) s = 0;
+	std::atomic<int> popped{ 0 };
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([&, t] {
+			for (int i = 0; i < perThread; i++) queue.push(t * perThread + i, i % 100);
+		});
+		workers.emplace_back([&] {
+			int item;
+			while (popped.load() < threads * perThread) {
+				if (queue.try_pop(item)) {
+					++seen[item];
+					++popped;
+				}
+			}
+		});
+	}
+	for (std::thread& w : workers) w.join();
+	for (std::atomic<int>& s : seen) assert(s.load() == 1);
+	assert(queue.is_empty());
+}
+
+struct Target {
+	int value;
+};
+
+void testNodes() {
+	MultiQueue<Target*> targets(1);
+	Target low{ 1 }, high{ 2 };
+	BT tree;
+	Blackboard& bb = tree.getBlackboard();
+	const Blackboard::Key target = Blackboard::key("target"), value = Blackboard::key("value");
+	const Blackboard::Key best = Blackboard::key("best");
+
+	PushPrio<Target> push(target, value, targets);
+	tree.setRootChild(&push);
+	assert(tree.tick() == BT::Status::ERROR);	// no priority yet
+	bb.set(target, &low);
+	bb.set(value, 1.0);
+	assert(tree.tick() == BT::Status::SUCCESS);
+	bb.set(target, &high);
+	bb.set(value, 2.0);
+	assert(tree.tick() == BT::Status::SUCCESS);
+	// NaN can't be ordered: rejected rather than breaking the heap.
+	bb.set(value, std::nan(""));
+	assert(tree.tick() == BT::Status::ERROR && targets.size() == 2);
+	// Nor can -infinity be told from an empty heap.
+	bb.set(value, -std::numeric_limits<double>::infinity());
+	assert(tree.tick() == BT::Status::ERROR && targets.size() == 2);
+
+	PopBest<Target> pop(best, targets);
+	tree.setRootChild(&pop);
+	assert(tree.tick() == BT::Status::SUCCESS && bb.get<Target*>(best, nullptr) == &high);
+	assert(tree.tick() == BT::Status::SUCCESS && bb.get<Target*>(best, nullptr) == &low);
+	assert(tree.tick() == BT::Status::FAILURE);
+}
+
+int main()
+{
+	testOrder();
+	testConcurrent();
+	testNodes();
+	std::cout << "MultiQueue tests passed." << std::endl;
+}
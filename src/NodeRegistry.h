@@ -0,0 +1,337 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include "BehaviourTree.h"
+#include "Arena.h"
+
+
+/*
+* Typed parameters of a node description, as read by the node factories.
+* Implemented over a plain list for the text formats, and directly over the
+* mapped file for the binary format.
+*/
+class NodeParams
+{
+public:
+    enum class Kind : uint32_t { INTEGER = 0, REAL = 1, STRING = 2 };
+
+    virtual ~NodeParams() = default;
+
+    virtual size_t size() const = 0;
+    virtual const char* name(size_t i) const = 0;
+    virtual Kind kind(size_t i) const = 0;
+    virtual int64_t integer(size_t i) const = 0;
+    virtual double real(size_t i) const = 0;
+    virtual const char* string(size_t i) const = 0;
+
+    // @return the index of the parameter, or -1
+    int find(const char* name) const {
+        for (size_t i = 0; i < size(); i++)
+            if (std::strcmp(this->name(i), name) == 0) return static_cast<int>(i);
+        return -1;
+    }
+
+    int64_t getInt(const char* name, const int64_t fallback = 0) const {
+        const int i = find(name);
+        if (i < 0 || kind(i) == Kind::STRING) return fallback;
+        return kind(i) == Kind::INTEGER ? integer(i) : static_cast<int64_t>(real(i));
+    }
+
+    double getReal(const char* name, const double fallback = 0.0) const {
+        const int i = find(name);
+        if (i < 0 || kind(i) == Kind::STRING) return fallback;
+        return kind(i) == Kind::REAL ? real(i) : static_cast<double>(integer(i));
+    }
+
+    std::string getString(const char* name, const std::string& fallback = std::string()) const {
+        const int i = find(name);
+        if (i < 0 || kind(i) != Kind::STRING) return fallback;
+        return string(i);
+    }
+
+    std::chrono::milliseconds getMillis(const char* name, const std::chrono::milliseconds fallback) const {
+        return std::chrono::milliseconds(getInt(name, fallback.count()));
+    }
+
+    // Blackboard keys listed by name, separated by commas, e.g. "health, target".
+    std::vector<Blackboard::Key> getKeys(const char* name) const {
+        std::vector<Blackboard::Key> keys;
+        const std::string list = getString(name);
+        size_t begin = 0;
+        while (begin < list.size()) {
+            size_t end = list.find(',', begin);
+            if (end == std::string::npos) end = list.size();
+            const size_t first = list.find_first_not_of(" \t", begin);
+            const size_t last = list.find_last_not_of(" \t", end - 1);
+            if (first < end && last != std::string::npos && last >= first)
+                keys.push_back(Blackboard::key(list.substr(first, last - first + 1)));
+            begin = end + 1;
+        }
+        return keys;
+    }
+
+    // "SUCCESS", "FAILURE", "RUNNING" or "ERROR"
+    BehaviourTree::Status getStatus(const char* name, const BehaviourTree::Status fallback) const {
+        const std::string s = getString(name);
+        if (s == "SUCCESS") return BehaviourTree::Status::SUCCESS;
+        if (s == "FAILURE") return BehaviourTree::Status::FAILURE;
+        if (s == "RUNNING") return BehaviourTree::Status::RUNNING;
+        if (s == "ERROR") return BehaviourTree::Status::ERROR;
+        return fallback;
+    }
+};
+
+// Parameters held in a list, filled by hand or by a text parser.
+class ParamList : public NodeParams
+{
+public:
+    ParamList& set(const std::string& name, const int64_t value) {
+        Param& p = slot(name);
+        p.kind = Kind::INTEGER;
+        p.i = value;
+        return *this;
+    }
+    ParamList& set(const std::string& name, const int value) { return set(name, static_cast<int64_t>(value)); }
+    ParamList& set(const std::string& name, const double value) {
+        Param& p = slot(name);
+        p.kind = Kind::REAL;
+        p.d = value;
+        return *this;
+    }
+    ParamList& set(const std::string& name, const std::string& value) {
+        Param& p = slot(name);
+        p.kind = Kind::STRING;
+        p.s = value;
+        return *this;
+    }
+    ParamList& set(const std::string& name, const char* value) { return set(name, std::string(value)); }
+
+    void clear() { params_.clear(); }
+
+    virtual size_t size() const override { return params_.size(); }
+    virtual const char* name(size_t i) const override { return params_[i].name.c_str(); }
+    virtual Kind kind(size_t i) const override { return params_[i].kind; }
+    virtual int64_t integer(size_t i) const override { return params_[i].i; }
+    virtual double real(size_t i) const override { return params_[i].d; }
+    virtual const char* string(size_t i) const override { return params_[i].s.c_str(); }
+
+private:
+    struct Param {
+        std::string name;
+        Kind kind = Kind::INTEGER;
+        int64_t i = 0;
+        double d = 0.0;
+        std::string s;
+    };
+
+    Param& slot(const std::string& name) {
+        for (Param& p : params_)
+            if (p.name == name) return p;
+        params_.emplace_back();
+        params_.back().name = name;
+        return params_.back();
+    }
+
+    std::vector<Param> params_;
+};
+
+/*
+* Maps node type names to the factories building them, so that trees can be
+* described as data. Factories construct their node in the given arena.
+*/
+class NodeRegistry
+{
+public:
+    typedef std::function<BehaviourTree::Node*(Arena&, const NodeParams&)> Factory;
+    // Builds the nodes of the types that have no factory, given their type name.
+    typedef std::function<BehaviourTree::Node*(Arena&, const std::string&, const NodeParams&)> Fallback;
+
+    void add(const std::string& type, Factory factory) {
+        auto it = ids_.find(type);
+        if (it != ids_.end()) {
+            factories_[it->second] = std::move(factory);
+            return;
+        }
+        ids_.emplace(type, static_cast<uint32_t>(factories_.size()));
+        factories_.push_back(std::move(factory));
+        names_.push_back(type);
+        nameIds_.push_back(BehaviourTree::Node::intern(type));
+    }
+
+    // Register a node type built by its default constructor.
+    template <typename N>
+    void add(const std::string& type) {
+        add(type, [](Arena& arena, const NodeParams&) -> BehaviourTree::Node* {
+            return arena.create<N>();
+        });
+    }
+
+    // @return the type id of a name, or NOT_FOUND
+    uint32_t id(const std::string& type) const {
+        auto it = ids_.find(type);
+        if (it == ids_.end()) return NOT_FOUND;
+        return it->second;
+    }
+
+    const std::string& name(const uint32_t id) const { return names_[id]; }
+
+    // The node is named after its type.
+    BehaviourTree::Node* create(const uint32_t id, Arena& arena, const NodeParams& params) const {
+        BehaviourTree::Node* node = factories_[id](arena, params);
+        if (node != nullptr) node->setName(nameIds_[id]);
+        return node;
+    }
+
+    // A registry knowing about the nodes of BehaviourTree that need no template argument.
+    static NodeRegistry withBuiltins() {
+        typedef BehaviourTree BT;
+        using std::chrono::milliseconds;
+        NodeRegistry r;
+        r.add<BT::Sequence>("Sequence");
+        r.add<BT::Select>("Select");
+        r.add<BT::Invert>("Invert");
+        r.add<BT::Succeed>("Succeed");
+        r.add<BT::Fail>("Fail");
+        r.add("Repeat", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Repeat>(static_cast<int>(p.getInt("count", -1)));
+        });
+        r.add("RepeatUntil", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::RepeatUntil>("", p.getStatus("status", BT::Status::FAILURE));
+        });
+        r.add("Async", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Async>(std::chrono::microseconds(p.getInt("poll_us", 10)));
+        });
+        r.add("Sleep", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Sleep>(p.getMillis("ms", milliseconds(1)));
+        });
+        r.add("Wait", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Wait>(p.getMillis("ms", milliseconds(1)));
+        });
+        r.add("Cooldown", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Cooldown>(p.getMillis("ms", milliseconds(1)));
+        });
+        r.add("Timeout", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Timeout>(p.getMillis("ms", milliseconds(1)));
+        });
+        r.add("Probability", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Probability>(p.getReal("p", 0.5));
+        });
+        r.add("Memo", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Memo>(p.getKeys("watch"));
+        });
+        r.add("Incremental", [](Arena& a, const NodeParams& p) -> BT::Node* {
+            return a.create<BT::Incremental>(p.getKeys("watch"));
+        });
+        return r;
+    }
+
+    // Accept any type, e.g. to read a description without building its nodes.
+    void setFallback(Fallback fallback) { fallback_ = std::move(fallback); }
+    bool hasFallback() const { return static_cast<bool>(fallback_); }
+
+    // A node of a type without a factory, named after its type.
+    BehaviourTree::Node* createFallback(const std::string& type, Arena& arena, const NodeParams& params) const {
+        BehaviourTree::Node* node = fallback_(arena, type, params);
+        if (node != nullptr) node->setName(type);
+        return node;
+    }
+
+    static const uint32_t NOT_FOUND = UINT32_MAX;
+
+private:
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<Factory> factories_;
+    std::vector<std::string> names_;
+    std::vector<BehaviourTree::Node::NameId> nameIds_;
+    Fallback fallback_;
+};
+
+/*
+* A tree built from a description. It owns its nodes, which all live in one arena.
+* Each node keeps the id given by the description, stable across versions of it.
+*/
+class LoadedTree
+{
+public:
+    LoadedTree() : arena_(16384) {}
+    LoadedTree(const LoadedTree&) = delete;
+    LoadedTree& operator=(const LoadedTree&) = delete;
+
+    BehaviourTree::Node* root() const { return nodes_.empty() ? nullptr : nodes_[root_]; }
+    size_t size() const { return nodes_.size(); }
+    BehaviourTree::Node* node(const size_t index) const { return nodes_[index]; }
+    uint32_t id(const size_t index) const { return ids_[index]; }
+
+    // Memory held by the nodes.
+    size_t footprint() const { return arena_.used(); }
+
+    // Builder interface, used by the loaders.
+    Arena& arena() { return arena_; }
+
+    /**
+     * Append a node made by a factory.
+     * @return false if there's no node, or if its id is already taken
+     */
+    bool add(BehaviourTree::Node* node, const uint32_t id, std::string* error) {
+        if (node == nullptr)
+            return fail(error, "node " + std::to_string(id) + " could not be created");
+        if (!used_.insert(id).second)
+            return fail(error, "duplicate node id " + std::to_string(id));
+        nodes_.push_back(node);
+        ids_.push_back(id);
+        return true;
+    }
+
+    void setRoot(const size_t index) { root_ = index; }
+
+    /**
+     * Make a node the child of another one.
+     * @return false if the parent can't take one more child
+     */
+    bool link(const size_t parent, const size_t child, std::string* error) {
+        BehaviourTree::Node* p = nodes_[parent];
+        if (BehaviourTree::CompositeNode* composite = dynamic_cast<BehaviourTree::CompositeNode*>(p)) {
+            composite->addChild(nodes_[child]);
+            return true;
+        }
+        if (BehaviourTree::DecoratorNode* decorator = dynamic_cast<BehaviourTree::DecoratorNode*>(p)) {
+            if (decorator->hasChild())
+                return fail(error, "node " + std::to_string(ids_[parent]) + " is a decorator with more than one child");
+            decorator->setChild(nodes_[child]);
+            return true;
+        }
+        return fail(error, "node " + std::to_string(ids_[parent]) + " is a leaf and can't have children");
+    }
+
+    /**
+     * Check the tree can be ticked, once its nodes are linked.
+     * @return false if it has no node, or if a decorator has no child
+     */
+    bool validate(std::string* error) const {
+        if (nodes_.empty()) return fail(error, "no node");
+        for (size_t i = 0; i < nodes_.size(); i++) {
+            const BehaviourTree::DecoratorNode* decorator = dynamic_cast<const BehaviourTree::DecoratorNode*>(nodes_[i]);
+            if (decorator != nullptr && !decorator->hasChild())
+                return fail(error, "node " + std::to_string(ids_[i]) + " is a decorator without a child");
+        }
+        return true;
+    }
+
+    static bool fail(std::string* error, const std::string& message) {
+        if (error) *error = message;
+        return false;
+    }
+
+private:
+    Arena arena_;
+    std::vector<BehaviourTree::Node*> nodes_;
+    std::vector<uint32_t> ids_;
+    std::unordered_set<uint32_t> used_;
+    size_t root_ = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+
+/*
+* xoshiro256** pseudo random number generator.
+* http://prng.di.unimi.it/
+* Small, fast and lock free, unlike std::rand(). Give each agent (or each
+* thread) its own instance: the same seed always replays the same sequence.
+* Meets the UniformRandomBitGenerator requirements, so it can also feed the
+* std:: distributions.
+*/
+class Random
+{
+public:
+    typedef uint64_t result_type;
+
+    explicit Random(const uint64_t seed = 0) { this->seed(seed); }
+
+    // The state is expanded from the seed with splitmix64, as advised by the authors.
+    void seed(uint64_t seed) {
+        for (auto& word : s_) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1).
+    double uniform() {
+        return static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform in [0, bound), without modulo bias (Lemire's method).
+    uint32_t below(const uint32_t bound) {
+        uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * bound;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < bound) {
+            const uint32_t threshold = static_cast<uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * bound;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // true with the given probability.
+    bool chance(const double probability) {
+        return uniform() < probability;
+    }
+
+    /**
+     * Advance by 2^128 draws: calling jump() n times on copies of one
+     * generator gives n non overlapping streams, e.g. one per thread.
+     */
+    void jump() {
+        static const uint64_t JUMP[] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+                                         0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+        uint64_t s[4] = { 0, 0, 0, 0 };
+        for (uint64_t j : JUMP) {
+            for (int b = 0; b < 64; b++) {
+                if (j & (uint64_t(1) << b))
+                    for (int i = 0; i < 4; i++) s[i] ^= s_[i];
+                (*this)();
+            }
+        }
+        for (int i = 0; i < 4; i++) s_[i] = s[i];
+    }
+
+    // A generator private to the calling thread, for code without a TickContext at hand.
+    static Random& local() {
+        static thread_local Random r(threadSeed());
+        return r;
+    }
+
+private:
+    static uint64_t rotl(const uint64_t x, const int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t threadSeed() {
+        static std::atomic<uint64_t> next{ 0 };
+        return next.fetch_add(1, std::memory_order_relaxed) + 0x5EED;
+    }
+
+    uint64_t s_[4];
+};
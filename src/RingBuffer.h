@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+* Bounded lock-free queue for many producers and a single consumer.
+* Each cell carries a sequence number telling whether it is free for the
+* producer of a given position or filled for the consumer, so that producers
+* only contend on a compare and swap of the tail (D. Vyukov's bounded queue).
+* Pushing to a full ring fails instead of waiting.
+*/
+template <typename T>
+class RingBuffer
+{
+public:
+    /**
+     * Constructor
+     * @param capacity rounded up to a power of two, 2 at least
+     */
+    explicit RingBuffer(const size_t capacity = 1024) :
+            mask_(roundUp(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; i++) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // May be called from any thread. @return false if the ring is full
+    bool try_push(const T& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only to be called by the consumer thread. @return false if the ring is empty
+    bool try_pop(T& item) {
+        Cell& cell = cells_[head_ & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != head_ + 1)
+            return false;
+        item = cell.item;
+        cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    static size_t roundUp(const size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    char padTail_[64];
+    std::atomic<size_t> tail_{ 0 };     // producers
+    char padHead_[64];                  // kept off the producers' cache line
+    size_t head_ = 0;                   // consumer
+};
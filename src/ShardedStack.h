@@ -0,0 +1,219 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "BehaviourTree.h"
+
+
+/*
+* A pool of items spread over several work stealing deques (Chase and Lev,
+* "Dynamic Circular Work-Stealing Deque", with the memory orders of Lê et al.).
+* Each thread pushes to and pops from its home deque, at the bottom, without
+* contention as long as the threads have deques of their own; a thread whose
+* deque is empty steals the oldest item of another deque, from the top, with
+* a single compare and swap.
+* Items are handed out LIFO per deque only: there is no global order.
+* Threads, including the short lived ones of Async nodes, are given home deques
+* in turn; a deque is owned by one thread at a time through a flag, so that
+* any number of threads may share a stack.
+*/
+template <typename T>
+class ShardedStack
+{
+	static_assert(std::is_trivially_copyable<T>::value, "ShardedStack holds trivially copyable items, e.g. pointers");
+
+public:
+	/**
+	 * Constructor
+	 * @param shards number of deques, the hardware concurrency by default
+	 */
+	explicit ShardedStack(const size_t shards = 0) :
+		count_(shards ? shards : std::max(1u, std::thread::hardware_concurrency())),
+		deques_(new Deque[count_]), serial_(nextSerial()) {}
+	ShardedStack(const ShardedStack&) = delete;
+	ShardedStack& operator=(const ShardedStack&) = delete;
+
+	void push(const T& item) {
+		Deque& d = claim();
+		d.push(item);
+		d.owned.store(false, std::memory_order_release);
+	}
+
+	// @return false if no deque had any item
+	bool try_pop(T& item) {
+		const size_t home = claimIndex();
+		Deque& d = deques_[home];
+		const bool found = d.take(item);
+		d.owned.store(false, std::memory_order_release);
+		if (found) return true;
+		for (size_t i = 1; i < count_; i++) {
+			if (deques_[(home + i) % count_].steal(item)) return true;
+		}
+		return false;
+	}
+
+	// Approximate while other threads push or pop.
+	size_t size() const {
+		size_t n = 0;
+		for (size_t i = 0; i < count_; i++) n += deques_[i].size();
+		return n;
+	}
+	bool is_empty() const { return size() == 0; }
+	size_t shards() const { return count_; }
+
+private:
+	// Grown by its owner, read by thieves: old arrays are kept until the deque dies,
+	// as a thief may still be reading one.
+	struct Array {
+		explicit Array(const size_t n) : mask(n - 1), items(new std::atomic<T>[n]) {}
+		const size_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+		std::unique_ptr<Array> previous;
+		T get(const int64_t i) const { return items[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed); }
+		void put(const int64_t i, const T& item) { items[static_cast<size_t>(i) & mask].store(item, std::memory_order_relaxed); }
+	};
+
+	struct Deque {
+		Deque() : array(new Array(16)) {}
+		~Deque() { delete array.load(); }
+
+		void push(const T& item) {
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_acquire);
+			Array* a = array.load(std::memory_order_relaxed);
+			if (b - t > static_cast<int64_t>(a->mask)) a = grow(a, b, t);
+			a->put(b, item);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		bool take(T& item) {
+			const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			Array* a = array.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			if (t > b) {
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			item = a->get(b);
+			if (t == b) {
+				// The last item: race the thieves for it.
+				const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		bool steal(T& item) {
+			for (;;) {
+				// Each attempt needs the fence between reading top and bottom, lest the
+				// owner's take() and this thread both get the last item.
+				int64_t t = top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const int64_t b = bottom.load(std::memory_order_acquire);
+				if (t >= b) return false;
+				Array* a = array.load(std::memory_order_acquire);
+				item = a->get(t);
+				if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					return true;
+				// Another thread took it: start over.
+			}
+		}
+
+		size_t size() const {
+			const int64_t n = bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+			return n > 0 ? static_cast<size_t>(n) : 0;
+		}
+
+		Array* grow(Array* a, const int64_t b, const int64_t t) {
+			Array* bigger = new Array((a->mask + 1) * 2);
+			for (int64_t i = t; i < b; i++) bigger->put(i, a->get(i));
+			bigger->previous.reset(a);
+			array.store(bigger, std::memory_order_release);
+			return bigger;
+		}
+
+		std::atomic<int64_t> top{ 0 };
+		char pad[64];               // thieves write top, the owner writes bottom
+		std::atomic<int64_t> bottom{ 0 };
+		std::atomic<Array*> array;
+		std::atomic<bool> owned{ false };
+	};
+
+	Deque& claim() { return deques_[claimIndex()]; }
+
+	// Own a deque, the thread's home one when free.
+	size_t claimIndex() {
+		struct Home {
+			uint64_t stack = 0;
+			size_t index = 0;
+		};
+		static thread_local Home home;
+		if (home.stack != serial_) {
+			home.stack = serial_;
+			home.index = next_.fetch_add(1, std::memory_order_relaxed) % count_;
+		}
+		for (size_t i = home.index;; i = (i + 1) % count_) {
+			bool expected = false;
+			if (!deques_[i].owned.load(std::memory_order_relaxed) &&
+				deques_[i].owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				return i;
+			if ((i + 1) % count_ == home.index) std::this_thread::yield();
+		}
+	}
+
+	// Tells stacks apart, unlike their addresses which may be reused.
+	static uint64_t nextSerial() {
+		static std::atomic<uint64_t> serial{ 0 };
+		return ++serial;
+	}
+
+	const size_t count_;
+	std::unique_ptr<Deque[]> deques_;
+	const uint64_t serial_;
+	std::atomic<size_t> next_{ 0 };
+};
+
+
+// Pop an item of a ShardedStack into a blackboard variable,
+// like BehaviourTree::Pop does from a ConcurrentStack: FAILURE if there is none.
+template <typename T>
+class ShardedPop : public BehaviourTree::Node {
+public:
+	ShardedPop(const Blackboard::Key t, ShardedStack<T*>& s) : stack(s), item(t) {}
+private:
+	ShardedStack<T*>& stack;
+	Blackboard::Key item;
+	virtual BehaviourTree::Status run(BehaviourTree::TickContext& ctx) override {
+		T* object;
+		if (!stack.try_pop(object))
+			return BehaviourTree::Status::FAILURE;
+		ctx.blackboard.set(item, object);
+		return BehaviourTree::Status::SUCCESS;
+	}
+};
+
+// Push a blackboard variable to a ShardedStack, like BehaviourTree::Push.
+template <typename T>
+class ShardedPush : public BehaviourTree::Node {
+public:
+	ShardedPush(const Blackboard::Key t, ShardedStack<T*>& s) : stack(s), item(t) {}
+private:
+	ShardedStack<T*>& stack;
+	Blackboard::Key item;
+	virtual BehaviourTree::Status run(BehaviourTree::TickContext& ctx) override {
+		T** object = ctx.blackboard.find<T*>(item);
+		if (object == nullptr)
+			return BehaviourTree::Status::ERROR;
+		stack.push(*object);
+		return BehaviourTree::Status::SUCCESS;
+	}
+};
@@ -0,0 +1,131 @@
+//
+// Work stealing stacks and their nodes.
+//
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "ShardedStack.h"
+
+typedef BehaviourTree BT;
+
+void testSingleThread() {
+	ShardedStack<int> stack(4);
+	assert(stack.shards() == 4 && stack.is_empty());
+	for (int i = 0; i < 100; i++) stack.push(i);	// beyond the initial capacity
+	assert(stack.size() == 100);
+	int item;
+	for (int i = 99; i >= 0; i--) assert(stack.try_pop(item) && item == i);
+	assert(!stack.try_pop(item));
+}
+
+void testStealing() {
+	ShardedStack<int> stack(4);
+	std::thread producer([&stack] { for (int i = 0; i < 10; i++) stack.push(i); });
+	producer.join();
+	// This thread's home deque is another one: the items are stolen, oldest first.
+	int item;
+	assert(stack.try_pop(item) && item == 0);
+	assert(stack.size() == 9);
+}
+
+void testConcurrent() {
+	const int producers = 4, perProducer = 20000;
+	ShardedStack<int> stack(4);
+	std::vector<std::atomic<int>> seen(producers * perProducer);
+	for (std::atomic<int>& s : seen) s = 0;
+	std::atomic<int> popped{ 0 };
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p] {
+			for (int i = 0; i < perProducer; i++) {
+				stack.push(p * perProducer + i);
+				int item;
+				if (i % 2 && stack.try_pop(item)) {
+					++seen[item];
+					++popped;
+				}
+			}
+		});
+		threads.emplace_back([&] {
+			int item;
+			while (popped.load() < producers * perProducer) {
+				if (stack.try_pop(item)) {
+					++seen[item];
+					++popped;
+				}
+			}
+		});
+	}
+	for (std::thread& t : threads) t.join();
+	for (std::atomic<int>& s : seen) assert(s.load() == 1);
+	assert(stack.is_empty());
+}
+
+void testStealRace() {
+	// The owner pushes and takes back on its deque, often down to the last item,
+	// while the other threads steal from it.
+	const int thieves = 3, items = 100000;
+	ShardedStack<int> stack(thieves + 1);
+	std::vector<std::atomic<int>> seen(items);
+	for (std::atomic<int>& s : seen) s = 0;
+	std::atomic<int> popped{ 0 };
+	std::vector<std::thread> threads;
+	threads.emplace_back([&] {
+		for (int i = 0; i < items; i++) {
+			stack.push(i);
+			int item;
+			if (i % 2 && stack.try_pop(item)) {
+				++seen[item];
+				++popped;
+			}
+		}
+	});
+	for (int t = 0; t < thieves; t++) {
+		threads.emplace_back([&] {
+			int item;
+			while (popped.load() < items) {
+				if (stack.try_pop(item)) {
+					++seen[item];
+					++popped;
+				}
+			}
+		});
+	}
+	for (std::thread& t : threads) t.join();
+	// No item came out twice, nor was any lost.
+	for (std::atomic<int>& s : seen) assert(s.load() == 1);
+	assert(stack.is_empty());
+}
+
+struct Door {
+	int doorNumber;
+};
+
+void testNodes() {
+	ShardedStack<Door*> doors(2);
+	Door door{ 3 };
+	BT tree;
+	const Blackboard::Key current = Blackboard::key("currentDoor");
+	tree.getBlackboard().set(current, &door);
+
+	ShardedPush<Door> push(current, doors);
+	ShardedPop<Door> pop(Blackboard::key("poppedDoor"), doors);
+	tree.setRootChild(&push);
+	assert(tree.tick() == BT::Status::SUCCESS);
+	tree.setRootChild(&pop);
+	assert(tree.tick() == BT::Status::SUCCESS);
+	assert(tree.getBlackboard().get<Door*>(Blackboard::key("poppedDoor"), nullptr) == &door);
+	assert(tree.tick() == BT::Status::FAILURE);
+}
+
+int main()
+{
+	testSingleThread();
+	testStealing();
+	testConcurrent();
+	testStealRace();
+	testNodes();
+	std::cout << "ShardedStack tests passed." << std::endl;
+}
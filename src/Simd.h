@@ -0,0 +1,147 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BT_HAS_SSE2 1
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BT_HAS_AVX 1
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BT_HAS_NEON 1
+#endif
+
+
+/*
+* Vectorized helpers over float arrays: 4 lanes at a time with SSE2 on x86-64
+* (8 with AVX when compiled for it) or NEON on ARM, plain loops elsewhere.
+* The results don't depend on which.
+*/
+namespace Simd
+{
+    // The largest value, NaNs ignored. -infinity if there is none.
+    inline float max(const float* values, const size_t n) {
+        float best = -std::numeric_limits<float>::infinity();
+        size_t i = 0;
+#if defined(BT_HAS_SSE2)
+        __m128 acc = _mm_set1_ps(best);
+        for (; i + 4 <= n; i += 4)
+            acc = _mm_max_ps(_mm_loadu_ps(values + i), acc);   // keeps acc when the value is NaN
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        for (const float lane : lanes) if (lane > best) best = lane;
+#elif defined(BT_HAS_NEON)
+        float32x4_t acc = vdupq_n_f32(best);
+        for (; i + 4 <= n; i += 4) {
+            const float32x4_t v = vld1q_f32(values + i);
+            acc = vbslq_f32(vcgtq_f32(v, acc), v, acc);         // NaN compares false
+        }
+        float lanes[4];
+        vst1q_f32(lanes, acc);
+        for (const float lane : lanes) if (lane > best) best = lane;
+#endif
+        for (; i < n; i++) if (values[i] > best) best = values[i];
+        return best;
+    }
+
+    // The index of the first occurrence of a value, or n.
+    inline size_t find(const float* values, const size_t n, const float value) {
+        size_t i = 0;
+#if defined(BT_HAS_SSE2)
+        const __m128 target = _mm_set1_ps(value);
+        for (; i + 4 <= n; i += 4) {
+            const int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(values + i), target));
+            if (mask != 0) {
+                size_t lane = 0;
+                while (!(mask & (1 << lane))) ++lane;
+                return i + lane;
+            }
+        }
+#endif
+        for (; i < n; i++) if (values[i] == value) return i;
+        return n;
+    }
+
+    /**
+     * The index of the largest value, the first one on ties, NaNs ignored.
+     * @return n if there are only NaNs
+     */
+    inline size_t argmax(const float* values, const size_t n) {
+        return find(values, n, max(values, n));
+    }
+
+    // Comparisons of compare(), ordered: any comparison with NaN is false, but NOT_EQUAL.
+    enum class Compare { LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, NOT_EQUAL };
+
+    inline bool holds(const float value, const Compare op, const float operand) {
+        switch (op) {
+        case Compare::LESS: return value < operand;
+        case Compare::LESS_EQUAL: return value <= operand;
+        case Compare::GREATER: return value > operand;
+        case Compare::GREATER_EQUAL: return value >= operand;
+        case Compare::EQUAL: return value == operand;
+        default: return !(value == operand);
+        }
+    }
+
+    namespace detail
+    {
+#if defined(BT_HAS_AVX)
+        template <Compare OP> __m256 lanes(const __m256 v, const __m256 x);
+        template <> inline __m256 lanes<Compare::LESS>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_LT_OQ); }
+        template <> inline __m256 lanes<Compare::LESS_EQUAL>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_LE_OQ); }
+        template <> inline __m256 lanes<Compare::GREATER>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_GT_OQ); }
+        template <> inline __m256 lanes<Compare::GREATER_EQUAL>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_GE_OQ); }
+        template <> inline __m256 lanes<Compare::EQUAL>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_EQ_OQ); }
+        template <> inline __m256 lanes<Compare::NOT_EQUAL>(const __m256 v, const __m256 x) { return _mm256_cmp_ps(v, x, _CMP_NEQ_UQ); }
+#elif defined(BT_HAS_SSE2)
+        template <Compare OP> __m128 lanes(const __m128 v, const __m128 x);
+        template <> inline __m128 lanes<Compare::LESS>(const __m128 v, const __m128 x) { return _mm_cmplt_ps(v, x); }
+        template <> inline __m128 lanes<Compare::LESS_EQUAL>(const __m128 v, const __m128 x) { return _mm_cmple_ps(v, x); }
+        template <> inline __m128 lanes<Compare::GREATER>(const __m128 v, const __m128 x) { return _mm_cmpgt_ps(v, x); }
+        template <> inline __m128 lanes<Compare::GREATER_EQUAL>(const __m128 v, const __m128 x) { return _mm_cmpge_ps(v, x); }
+        template <> inline __m128 lanes<Compare::EQUAL>(const __m128 v, const __m128 x) { return _mm_cmpeq_ps(v, x); }
+        template <> inline __m128 lanes<Compare::NOT_EQUAL>(const __m128 v, const __m128 x) { return _mm_cmpneq_ps(v, x); }
+#endif
+
+        template <Compare OP>
+        void compare(const float* values, const size_t n, const float operand, uint64_t* mask) {
+            size_t i = 0;
+#if defined(BT_HAS_AVX)
+            const __m256 x = _mm256_set1_ps(operand);
+            for (; i + 8 <= n; i += 8) {
+                const int bits = _mm256_movemask_ps(lanes<OP>(_mm256_loadu_ps(values + i), x));
+                mask[i / 64] |= static_cast<uint64_t>(bits) << (i % 64);
+            }
+#elif defined(BT_HAS_SSE2)
+            const __m128 x = _mm_set1_ps(operand);
+            for (; i + 4 <= n; i += 4) {
+                const int bits = _mm_movemask_ps(lanes<OP>(_mm_loadu_ps(values + i), x));
+                mask[i / 64] |= static_cast<uint64_t>(bits) << (i % 64);
+            }
+#endif
+            for (; i < n; i++)
+                if (holds(values[i], OP, operand)) mask[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+    /**
+     * Compare each value with an operand, into a bitmask: bit i % 64 of mask[i / 64]
+     * is set if values[i] <op> operand. The bits past n are cleared.
+     * @param mask (n + 63) / 64 words
+     */
+    inline void compare(const float* values, const size_t n, const Compare op, const float operand, uint64_t* mask) {
+        for (size_t w = 0; w < (n + 63) / 64; w++) mask[w] = 0;
+        switch (op) {
+        case Compare::LESS: detail::compare<Compare::LESS>(values, n, operand, mask); break;
+        case Compare::LESS_EQUAL: detail::compare<Compare::LESS_EQUAL>(values, n, operand, mask); break;
+        case Compare::GREATER: detail::compare<Compare::GREATER>(values, n, operand, mask); break;
+        case Compare::GREATER_EQUAL: detail::compare<Compare::GREATER_EQUAL>(values, n, operand, mask); break;
+        case Compare::EQUAL: detail::compare<Compare::EQUAL>(values, n, operand, mask); break;
+        case Compare::NOT_EQUAL: detail::compare<Compare::NOT_EQUAL>(values, n, operand, mask); break;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+
+/*
+* A vector of trivially copyable items keeping its first N items inline,
+* so that short lists need no allocation and are read from the owner's own
+* cache line. It only spills to the heap beyond N items.
+*/
+template <typename T, size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable items");
+    static_assert(N > 0, "SmallVector needs some inline capacity");
+
+public:
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SmallVector() = default;
+    SmallVector(const SmallVector& rhs) { assign(rhs); }
+    SmallVector& operator=(const SmallVector& rhs) {
+        if (this != &rhs) {
+            size_ = 0;
+            assign(rhs);
+        }
+        return *this;
+    }
+    ~SmallVector() { release(); }
+
+    void push_back(const T& item) {
+        if (size_ == capacity_) grow(capacity_ * 2);
+        data_[size_++] = item;
+    }
+
+    void clear() { size_ = 0; }
+    void reserve(const size_t capacity) { if (capacity > capacity_) grow(capacity); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // True while the items are still stored inline.
+    bool isInline() const { return data_ == inline_; }
+
+    T& operator[](const size_t i) { return data_[i]; }
+    const T& operator[](const size_t i) const { return data_[i]; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+private:
+    void assign(const SmallVector& rhs) {
+        reserve(rhs.size_);
+        std::memcpy(data_, rhs.data_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+    }
+
+    void grow(const size_t capacity) {
+        T* bigger = new T[capacity];
+        std::memcpy(bigger, data_, size_ * sizeof(T));
+        release();
+        data_ = bigger;
+        capacity_ = static_cast<uint32_t>(capacity);
+    }
+
+    void release() {
+        if (!isInline()) delete[] data_;
+        data_ = inline_;
+    }
+
+    T* data_ = inline_;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = N;
+    T inline_[N];
+};
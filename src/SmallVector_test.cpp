@@ -0,0 +1,46 @@
+//
+// Inline storage of the composites' children.
+//
+
+#include <iostream>
+#include <cassert>
+#include "BehaviourTree.h"
+
+typedef BehaviourTree BT;
+
+void testSmallVector() {
+	int items[6] = { 0, 1, 2, 3, 4, 5 };
+	SmallVector<int*, 4> v;
+	for (int i = 0; i < 4; i++) v.push_back(&items[i]);
+	assert(v.size() == 4 && v.isInline());
+
+	SmallVector<int*, 4> copy(v);
+	assert(copy.isInline() && copy[3] == &items[3]);
+
+	v.push_back(&items[4]);
+	v.push_back(&items[5]);
+	assert(v.size() == 6 && !v.isInline());
+	int expected = 0;
+	for (int* item : v) assert(*item == expected++);
+
+	copy = v;
+	assert(copy.size() == 6 && copy[5] == &items[5]);
+	v.clear();
+	assert(v.empty() && copy.size() == 6);
+}
+
+void testComposite() {
+	BT::Sequence sequence;
+	BT::Succeed a, b, c;
+	sequence.addChildren({ &a, &b, &c });
+	// The children are read from the composite's own cache line.
+	assert(sequence.getChildren().isInline());
+	assert(reinterpret_cast<const char*>(sequence.getChildren().data()) < reinterpret_cast<const char*>(&sequence) + sizeof(sequence));
+}
+
+int main()
+{
+	testSmallVector();
+	testComposite();
+	std::cout << "SmallVector tests passed." << std::endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "BehaviourTree.h"
+#include "RingBuffer.h"
+
+
+/*
+* A Tracer publishing the Status changes of the nodes, i.e. every tick whose
+* Status differs from the node's previous one, to a lock-free ring buffer.
+* The ticking threads only push; monitoring tools poll the transitions from
+* another thread instead of reading the nodes' state. Transitions that don't
+* fit in the ring are dropped and counted.
+*/
+class StatusObserver : public BehaviourTree::Tracer
+{
+public:
+    typedef BehaviourTree BT;
+
+    struct Transition {
+        const BT::Node* node;
+        BT::Node::NameId type;      // the node's name, i.e. its type when built by a NodeRegistry
+        BT::Status from;
+        BT::Status to;
+        uint64_t tickId;
+        uint64_t agentId;
+    };
+
+    /**
+     * Constructor
+     * @param capacity number of transitions the ring holds until polled
+     */
+    explicit StatusObserver(const size_t capacity = 4096) : ring_(capacity) {}
+
+    /**
+     * Only publish the transitions of the nodes of a type. May be called several times.
+     * Not to be called while a tree is being ticked.
+     */
+    void watch(const std::string& type) {
+        const BT::Node::NameId id = BT::Node::intern(type);
+        if (id >= watched_.size()) watched_.resize(id + 1, false);
+        watched_[id] = true;
+        filtered_ = true;
+    }
+
+    void enter(const BT::Node&, const BT::TickContext&) override {}
+    void exit(const BT::Node& node, const BT::TickContext& ctx, const BT::Status status) override {
+        const BT::Status previous = node.getTickStatus();
+        if (status == previous || !watches(node.getNameId()))
+            return;
+        if (!ring_.try_push(Transition{ &node, node.getNameId(), previous, status, ctx.tickId, ctx.agentId }))
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Only to be called by a single consumer thread. @return false if there is none
+    bool poll(Transition& transition) { return ring_.try_pop(transition); }
+
+    // Hand all the pending transitions to a function. @return their number
+    template <typename F>
+    size_t drain(F f) {
+        Transition t;
+        size_t n = 0;
+        while (ring_.try_pop(t)) {
+            f(t);
+            ++n;
+        }
+        return n;
+    }
+
+    size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    bool watches(const BT::Node::NameId type) const {
+        return !filtered_ || (type < watched_.size() && watched_[type]);
+    }
+
+    RingBuffer<Transition> ring_;
+    std::vector<bool> watched_;
+    bool filtered_ = false;
+    std::atomic<size_t> dropped_{ 0 };
+};
@@ -0,0 +1,103 @@
+//
+// Status transitions published to a lock-free ring.
+//
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "StatusObserver.h"
+#include "ChromeTracer.h"
+
+typedef BehaviourTree BT;
+using std::chrono::milliseconds;
+
+void testRing() {
+	RingBuffer<int> ring(3);
+	assert(ring.capacity() == 4);
+	for (int i = 0; i < 4; i++) assert(ring.try_push(i));
+	assert(!ring.try_push(4));
+	int item;
+	assert(ring.try_pop(item) && item == 0);
+	assert(ring.try_push(4));
+
+	// Many producers, one consumer: every item arrives once.
+	RingBuffer<int> shared(1024);
+	std::vector<std::thread> producers;
+	for (int p = 0; p < 4; p++) {
+		producers.emplace_back([&shared, p] {
+			for (int i = 0; i < 10000; i++)
+				while (!shared.try_push(p * 10000 + i)) std::this_thread::yield();
+		});
+	}
+	std::vector<bool> seen(40000, false);
+	for (int n = 0; n < 40000;) {
+		if (shared.try_pop(item)) {
+			assert(!seen[item]);
+			seen[item] = true;
+			++n;
+		}
+	}
+	for (std::thread& t : producers) t.join();
+	assert(!shared.try_pop(item));
+}
+
+void testTransitions() {
+	BT tree;
+	BT::Sleep sleep(milliseconds(5));
+	sleep.setName("Sleep");
+	BT::Sequence sequence;
+	sequence.setName("Sequence");
+	sequence.addChildren({ &sleep });
+	tree.setRootChild(&sequence);
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+
+	StatusObserver observer;
+	tree.getContext().tracer = &observer;
+	tree.tick(t0);
+	tree.tick(t0 + milliseconds(1));	// still RUNNING: no transition
+	tree.tick(t0 + milliseconds(5));
+
+	std::vector<StatusObserver::Transition> seen;
+	assert(observer.drain([&](const StatusObserver::Transition& t) { seen.push_back(t); }) == 4);
+	assert(seen[0].node == &sleep && seen[0].from == BT::Status::NOTRUN && seen[0].to == BT::Status::RUNNING);
+	assert(seen[0].tickId == 1);
+	assert(seen[1].node == &sequence && seen[1].to == BT::Status::RUNNING);
+	assert(seen[2].node == &sleep && seen[2].from == BT::Status::RUNNING && seen[2].to == BT::Status::SUCCESS);
+	assert(seen[2].tickId == 3 && seen[3].node == &sequence);
+	assert(observer.dropped() == 0);
+}
+
+void testFilterAndFanOut() {
+	BT tree;
+	BT::Sleep sleep(milliseconds(5));
+	sleep.setName("Sleep");
+	BT::Sequence sequence;
+	sequence.addChildren({ &sleep });
+	tree.setRootChild(&sequence);
+
+	StatusObserver observer(2);
+	observer.watch("Sleep");
+	ChromeTracer chrome;
+	BT::Tracers tracers{ &observer, &chrome };
+	tree.getContext().tracer = &tracers;
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+	tree.tick(t0);
+	tree.tick(t0 + milliseconds(5));
+	tree.tick(t0 + milliseconds(6));
+
+	StatusObserver::Transition t;
+	assert(observer.poll(t) && t.node == &sleep && t.to == BT::Status::RUNNING);
+	assert(observer.poll(t) && t.node == &sleep && t.to == BT::Status::SUCCESS);
+	assert(!observer.poll(t));
+	assert(observer.dropped() == 1);	// the ring only holds two transitions
+	assert(chrome.events() == 12);
+}
+
+int main()
+{
+	testRing();
+	testTransitions();
+	testFilterAndFanOut();
+	std::cout << "StatusObserver tests passed." << std::endl;
+}
@@ -0,0 +1,109 @@
+//
+// Shared subtrees: one definition, a state per instance.
+//
+
+#include <iostream>
+#include <cassert>
+#include "BehaviourTree.h"
+
+typedef BehaviourTree BT;
+using std::chrono::milliseconds;
+
+class Counter : public BT::Node {
+public:
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override { ++runs; return BT::Status::SUCCESS; }
+};
+
+void testInstances() {
+	// Sequence[ Sleep(5), Counter ], defined once.
+	BT::Sequence sequence;
+	BT::Sleep sleep(milliseconds(5));
+	Counter counter;
+	sequence.addChildren({ &sleep, &counter });
+	BT::Subtree definition(&sequence);
+	assert(definition.size() == 3);
+
+	BT::SubtreeRef first(definition), second(definition);
+	BT a, b;
+	a.setRootChild(&first);
+	b.setRootChild(&second);
+	const TimerWheel::Clock::time_point ta = a.getTimers().now();
+	const TimerWheel::Clock::time_point tb = b.getTimers().now();
+
+	assert(a.tick(ta) == BT::Status::RUNNING);
+	assert(b.tick(tb + milliseconds(3)) == BT::Status::RUNNING);
+	assert(a.tick(ta + milliseconds(5)) == BT::Status::SUCCESS);
+	assert(counter.runs == 1 && first.isCompleted());
+	// The second instance slept from its own first tick on.
+	assert(b.tick(tb + milliseconds(5)) == BT::Status::RUNNING);
+	assert(!second.isCompleted());
+	assert(b.tick(tb + milliseconds(8)) == BT::Status::SUCCESS);
+	assert(counter.runs == 2);
+}
+
+void testHalt() {
+	BT::Sleep sleep(milliseconds(5));
+	BT::Subtree definition(&sleep);
+	BT::SubtreeRef ref(definition);
+	BT tree;
+	tree.setRootChild(&ref);
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+
+	assert(tree.tick(t0) == BT::Status::RUNNING);
+	assert(tree.getTimers().pending() == 1);
+	static_cast<BT::Node&>(ref).halt(tree.getContext());
+	assert(tree.getTimers().pending() == 0);
+	// Starts over.
+	assert(tree.tick(t0 + milliseconds(5)) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(10)) == BT::Status::SUCCESS);
+}
+
+// A condition declaring the variable it reads.
+class Sensor : public BT::Node {
+public:
+	explicit Sensor(const Blackboard::Key k) : key(k) {}
+	Blackboard::Key key;
+	int runs = 0;
+	BT::Status run(BT::TickContext& ctx) override {
+		++runs;
+		return ctx.blackboard.get<int>(key) > 0 ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+	bool reads(std::vector<Blackboard::Key>& keys) const override {
+		keys.push_back(key);
+		return true;
+	}
+};
+
+void testCaches() {
+	const Blackboard::Key enemies = Blackboard::key("enemies");
+	Sensor sensor(enemies);
+	BT::Incremental incremental;
+	incremental.setChild(&sensor);
+	BT::Subtree definition(&incremental);
+	BT::SubtreeRef first(definition), second(definition);
+	BT a, b;
+	a.setRootChild(&first);
+	b.setRootChild(&second);
+	a.getBlackboard().set(enemies, 1);
+	b.getBlackboard().set(enemies, 0);
+
+	// An instance ticked again keeps its cache.
+	assert(a.tick() == BT::Status::SUCCESS && sensor.runs == 1);
+	assert(a.tick() == BT::Status::SUCCESS && sensor.runs == 1);
+	// So does each instance, across the ticks of the other.
+	assert(b.tick() == BT::Status::FAILURE && sensor.runs == 2);
+	assert(a.tick() == BT::Status::SUCCESS && sensor.runs == 2);
+	assert(b.tick() == BT::Status::FAILURE && sensor.runs == 2);
+	a.getBlackboard().set(enemies, 0);
+	assert(a.tick() == BT::Status::FAILURE && sensor.runs == 3);
+	assert(b.tick() == BT::Status::FAILURE && sensor.runs == 3);
+}
+
+int main()
+{
+	testInstances();
+	testHalt();
+	testCaches();
+	std::cout << "Subtree tests passed." << std::endl;
+}
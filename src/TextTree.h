@@ -0,0 +1,453 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include "NodeRegistry.h"
+
+
+/*
+* Loaders for trees described as JSON or XML text.
+* The text is read in a single pass: each node is built through the registry
+* as soon as its type and parameters are known, straight into the arena of
+* the LoadedTree, and no document tree is ever built.
+*
+* JSON: every node is an object, whose "type" and "params" must come before
+* its "children". "id" is an optional stable node id.
+*   { "type": "Sequence", "id": 1, "children": [
+*       { "type": "Repeat", "params": { "count": 3 }, "children": [ { "type": "DoorAction" } ] } ] }
+*
+* XML: every node is an element named after its type, whose attributes are its
+* parameters, typed as integers, reals or strings after their content.
+*   <Sequence id="1"> <Repeat count="3"> <DoorAction/> </Repeat> </Sequence>
+*
+* Nodes are nested Parser::MAX_DEPTH levels deep at most, as the parser recurses.
+*/
+namespace TextTree {
+
+    class Parser {
+    public:
+        Parser(const char* text, const size_t size, const NodeRegistry& registry, std::string* error) :
+            p_(text), end_(text + size), registry_(registry), error_(error), tree_(new LoadedTree) {}
+
+        std::unique_ptr<LoadedTree> json() {
+            skipSpace();
+            if (!jsonNode(NO_PARENT, 1)) return fail();
+            skipSpace();
+            if (p_ != end_) return fail("trailing characters after the root node");
+            return done();
+        }
+
+        std::unique_ptr<LoadedTree> xml() {
+            if (!xmlProlog()) return fail();
+            if (!xmlElement(NO_PARENT, 1)) return fail();
+            if (!xmlProlog()) return fail();
+            if (p_ != end_) return fail("trailing characters after the root element");
+            return done();
+        }
+
+        static const size_t MAX_DEPTH = 1000;
+
+    private:
+        static const size_t NO_PARENT = SIZE_MAX;
+        static constexpr const char* ID_RANGE = "\"id\" must be an integer from 0 to 4294967295";
+
+        static bool validId(const int64_t id) { return id >= 0 && id <= int64_t(UINT32_MAX); }
+
+        // Build a node from the current type and parameters.
+        bool create(const std::string& type, const int64_t id, const size_t parent, size_t& index) {
+            const uint32_t factory = registry_.id(type);
+            if (factory == NodeRegistry::NOT_FOUND && !registry_.hasFallback())
+                return error("unknown node type " + type);
+            index = tree_->size();
+            const uint32_t stableId = id < 0 ? static_cast<uint32_t>(index) : static_cast<uint32_t>(id);
+            std::string message;
+            if (!tree_->add(factory == NodeRegistry::NOT_FOUND ? registry_.createFallback(type, tree_->arena(), params_)
+                                                               : registry_.create(factory, tree_->arena(), params_),
+                            stableId, &message))
+                return error(message);
+            if (parent != NO_PARENT) {
+                if (!tree_->link(parent, index, &message)) return error(message);
+            }
+            return true;
+        }
+
+        // JSON
+
+        bool jsonNode(const size_t parent, const size_t depth) {
+            if (depth > MAX_DEPTH) return error("nodes nested deeper than " + std::to_string(MAX_DEPTH) + " levels");
+            if (!expect('{')) return false;
+            std::string type, key;
+            int64_t id = -1;
+            size_t index = NO_PARENT;
+            params_.clear();
+            skipSpace();
+            if (peek() == '}') return error("a node needs a type");
+            do {
+                skipSpace();
+                if (!jsonString(key) || !expect(':')) return false;
+                skipSpace();
+                if (key == "children") {
+                    if (index == NO_PARENT && !create(type, id, parent, index)) return false;
+                    if (!jsonChildren(index, depth + 1)) return false;
+                }
+                else if (index != NO_PARENT) {
+                    return error("\"" + key + "\" must come before \"children\"");
+                }
+                else if (key == "type") {
+                    if (!jsonString(type)) return false;
+                }
+                else if (key == "id") {
+                    ParamList value;
+                    if (!jsonScalar("id", value) || value.kind(0) != NodeParams::Kind::INTEGER || !validId(value.integer(0)))
+                        return error(ID_RANGE);
+                    id = value.integer(0);
+                }
+                else if (key == "params") {
+                    if (!jsonParams()) return false;
+                }
+                else if (!jsonSkip()) {
+                    return false;
+                }
+                skipSpace();
+            } while (accept(','));
+            if (!expect('}')) return false;
+            if (type.empty()) return error("a node needs a type");
+            return index != NO_PARENT || create(type, id, parent, index);
+        }
+
+        bool jsonChildren(const size_t parent, const size_t depth) {
+            if (!expect('[')) return false;
+            skipSpace();
+            if (accept(']')) return true;
+            do {
+                skipSpace();
+                if (!jsonNode(parent, depth)) return false;
+                skipSpace();
+            } while (accept(','));
+            return expect(']');
+        }
+
+        bool jsonParams() {
+            if (!expect('{')) return false;
+            skipSpace();
+            if (accept('}')) return true;
+            std::string name;
+            do {
+                skipSpace();
+                if (!jsonString(name) || !expect(':')) return false;
+                skipSpace();
+                if (!jsonScalar(name, params_)) return false;
+                skipSpace();
+            } while (accept(','));
+            return expect('}');
+        }
+
+        // A number, string or boolean, stored under name.
+        bool jsonScalar(const std::string& name, ParamList& params) {
+            const char c = peek();
+            if (c == '"') {
+                std::string value;
+                if (!jsonString(value)) return false;
+                params.set(name, value);
+                return true;
+            }
+            if (literal("true")) { params.set(name, 1); return true; }
+            if (literal("false")) { params.set(name, 0); return true; }
+            const char* start = p_;
+            while (p_ != end_ && (std::isdigit(static_cast<unsigned char>(*p_)) || std::strchr("+-.eE", *p_)))
+                ++p_;
+            if (start == p_) return error("expected a number, a string or a boolean");
+            return typed(name, std::string(start, p_), params);
+        }
+
+        bool jsonString(std::string& out) {
+            if (!expect('"')) return false;
+            out.clear();
+            while (p_ != end_ && *p_ != '"') {
+                char c = *p_++;
+                if (c == '\n') ++line_;
+                if (c != '\\') { out += c; continue; }
+                if (p_ == end_) break;
+                c = *p_++;
+                switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (end_ - p_ < 4) return error("truncated \\u escape");
+                    const unsigned long cp = std::strtoul(std::string(p_, p_ + 4).c_str(), nullptr, 16);
+                    p_ += 4;
+                    utf8(cp, out);
+                    break;
+                }
+                default: out += c; break;
+                }
+            }
+            return expect('"');
+        }
+
+        // Skip any JSON value of a key this loader doesn't know about.
+        bool jsonSkip() {
+            const char c = peek();
+            if (c == '"') {
+                std::string ignored;
+                return jsonString(ignored);
+            }
+            if (c == '{' || c == '[') {
+                int depth = 0;
+                while (p_ != end_) {
+                    const char d = peek();
+                    if (d == '"') {
+                        std::string ignored;
+                        if (!jsonString(ignored)) return false;
+                        continue;
+                    }
+                    if (d == '\n') ++line_;
+                    ++p_;
+                    if (d == '{' || d == '[') ++depth;
+                    else if ((d == '}' || d == ']') && --depth == 0) return true;
+                }
+                return error("unterminated value");
+            }
+            while (p_ != end_ && !std::strchr(",}] \t\r\n", *p_)) ++p_;
+            return true;
+        }
+
+        // XML
+
+        // Skip the declaration, comments and blanks around the root element.
+        bool xmlProlog() {
+            for (;;) {
+                skipSpace();
+                if (starts("<?")) {
+                    if (!skipPast("?>")) return error("unterminated declaration");
+                }
+                else if (starts("<!--")) {
+                    if (!skipPast("-->")) return error("unterminated comment");
+                }
+                else {
+                    return true;
+                }
+            }
+        }
+
+        bool xmlElement(const size_t parent, const size_t depth) {
+            if (depth > MAX_DEPTH) return error("nodes nested deeper than " + std::to_string(MAX_DEPTH) + " levels");
+            if (!expect('<')) return false;
+            const std::string type = xmlName();
+            if (type.empty()) return error("expected an element name");
+            int64_t id = -1;
+            params_.clear();
+            for (;;) {
+                skipSpace();
+                if (peek() == '/' || peek() == '>' || p_ == end_) break;
+                const std::string name = xmlName();
+                skipSpace();
+                if (name.empty() || !expect('=')) return error("expected an attribute");
+                skipSpace();
+                const char quote = peek();
+                if (quote != '"' && quote != '\'') return error("expected a quoted attribute value");
+                ++p_;
+                std::string value;
+                while (p_ != end_ && *p_ != quote) {
+                    if (*p_ == '&') {
+                        if (!xmlEntity(value)) return false;
+                    }
+                    else {
+                        if (*p_ == '\n') ++line_;
+                        value += *p_++;
+                    }
+                }
+                if (!expect(quote)) return false;
+                if (name == "id") {
+                    ParamList parsed;
+                    if (!typed(name, value, parsed) || parsed.kind(0) != NodeParams::Kind::INTEGER || !validId(parsed.integer(0)))
+                        return error(ID_RANGE);
+                    id = parsed.integer(0);
+                }
+                else if (!typed(name, value, params_)) {
+                    return false;
+                }
+            }
+            size_t index;
+            if (!create(type, id, parent, index)) return false;
+            if (accept('/')) return expect('>');
+            if (!expect('>')) return false;
+            for (;;) {
+                if (!xmlProlog()) return false;
+                if (starts("</")) {
+                    p_ += 2;
+                    if (xmlName() != type) return error("mismatched closing tag, expected " + type);
+                    skipSpace();
+                    return expect('>');
+                }
+                if (peek() != '<') return error("text content is not allowed in " + type);
+                if (!xmlElement(index, depth + 1)) return false;
+            }
+        }
+
+        std::string xmlName() {
+            const char* start = p_;
+            while (p_ != end_ && (std::isalnum(static_cast<unsigned char>(*p_)) || std::strchr("_-:.", *p_)))
+                ++p_;
+            return std::string(start, p_);
+        }
+
+        bool xmlEntity(std::string& out) {
+            static const char* const names[] = { "&lt;", "&gt;", "&amp;", "&quot;", "&apos;" };
+            static const char chars[] = { '<', '>', '&', '"', '\'' };
+            for (size_t i = 0; i < sizeof(chars); i++) {
+                if (starts(names[i])) {
+                    p_ += std::strlen(names[i]);
+                    out += chars[i];
+                    return true;
+                }
+            }
+            return error("unknown entity");
+        }
+
+        // Shared
+
+        // Store a textual value as an integer, a real or else a string.
+        bool typed(const std::string& name, const std::string& value, ParamList& params) {
+            if (!value.empty()) {
+                char* stop = nullptr;
+                errno = 0;
+                const long long i = std::strtoll(value.c_str(), &stop, 10);
+                if (*stop == '\0' && errno == 0) {
+                    params.set(name, static_cast<int64_t>(i));
+                    return true;
+                }
+                const double d = std::strtod(value.c_str(), &stop);
+                if (*stop == '\0') {
+                    params.set(name, d);
+                    return true;
+                }
+            }
+            params.set(name, value);
+            return true;
+        }
+
+        static void utf8(const unsigned long cp, std::string& out) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            }
+            else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        char peek() const { return p_ == end_ ? '\0' : *p_; }
+
+        bool starts(const char* s) const {
+            const size_t n = std::strlen(s);
+            return static_cast<size_t>(end_ - p_) >= n && std::memcmp(p_, s, n) == 0;
+        }
+
+        bool literal(const char* s) {
+            if (!starts(s)) return false;
+            p_ += std::strlen(s);
+            return true;
+        }
+
+        bool skipPast(const char* s) {
+            while (p_ != end_ && !starts(s)) {
+                if (*p_ == '\n') ++line_;
+                ++p_;
+            }
+            return literal(s);
+        }
+
+        void skipSpace() {
+            while (p_ != end_ && std::isspace(static_cast<unsigned char>(*p_))) {
+                if (*p_ == '\n') ++line_;
+                ++p_;
+            }
+        }
+
+        bool accept(const char c) {
+            if (peek() != c) return false;
+            ++p_;
+            return true;
+        }
+
+        bool expect(const char c) {
+            skipSpace();
+            if (accept(c)) return true;
+            return error(std::string("expected '") + c + "'");
+        }
+
+        bool error(const std::string& message) {
+            if (message_.empty())
+                message_ = "line " + std::to_string(line_) + ": " + message;
+            return false;
+        }
+
+        std::unique_ptr<LoadedTree> fail(const std::string& message = std::string()) {
+            if (!message.empty()) error(message);
+            LoadedTree::fail(error_, message_);
+            return std::unique_ptr<LoadedTree>();
+        }
+
+        std::unique_ptr<LoadedTree> done() {
+            if (!tree_->validate(&message_)) return fail();
+            tree_->setRoot(0);
+            return std::move(tree_);
+        }
+
+        const char* p_;
+        const char* end_;
+        const NodeRegistry& registry_;
+        std::string* error_;
+        std::unique_ptr<LoadedTree> tree_;
+        ParamList params_;          // parameters of the node being read, reused
+        std::string message_;
+        size_t line_ = 1;
+    };
+
+    /**
+     * Build a tree from its JSON description.
+     * @return nullptr if the text is malformed or uses unknown node types
+     */
+    inline std::unique_ptr<LoadedTree> loadJson(const std::string& text, const NodeRegistry& registry,
+                                                std::string* error = nullptr) {
+        return Parser(text.data(), text.size(), registry, error).json();
+    }
+
+    // Build a tree from its XML description.
+    inline std::unique_ptr<LoadedTree> loadXml(const std::string& text, const NodeRegistry& registry,
+                                               std::string* error = nullptr) {
+        return Parser(text.data(), text.size(), registry, error).xml();
+    }
+
+    // Build a tree from a JSON or XML file, told apart by their first character.
+    inline std::unique_ptr<LoadedTree> load(const std::string& path, const NodeRegistry& registry,
+                                            std::string* error = nullptr) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        if (!file) {
+            LoadedTree::fail(error, "can't open " + path);
+            return std::unique_ptr<LoadedTree>();
+        }
+        const std::string text = buffer.str();
+        const size_t first = text.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && text[first] == '<')
+            return loadXml(text, registry, error);
+        return loadJson(text, registry, error);
+    }
+}
@@ -0,0 +1,130 @@
+//
+// JSON and XML tree descriptions.
+//
+
+#include <iostream>
+#include <cassert>
+#include "TextTree.h"
+
+typedef BehaviourTree BT;
+
+class DoorAction : public BT::Node {
+public:
+	DoorAction(const std::string& name, int prob) : name(name), probabilityOfSuccess(prob) {}
+	std::string name;
+	int probabilityOfSuccess;
+	int runs = 0;
+	BT::Status run(BT::TickContext& ctx) override {
+		++runs;
+		return ctx.rng.below(100) < static_cast<uint32_t>(probabilityOfSuccess) ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+};
+
+NodeRegistry makeRegistry() {
+	NodeRegistry registry = NodeRegistry::withBuiltins();
+	registry.add("DoorAction", [](Arena& a, const NodeParams& p) -> BT::Node* {
+		return a.create<DoorAction>(p.getString("name"), static_cast<int>(p.getInt("probability", 50)));
+	});
+	return registry;
+}
+
+const char* const JSON = R"({
+	"type": "Sequence", "id": 10, "comment": ["ignored", { "nested": true }],
+	"children": [
+		{ "type": "DoorAction", "params": { "name": "Walk to door", "probability": 100 } },
+		{ "type": "Select", "children": [
+			{ "type": "DoorAction", "params": { "name": "Open \"door\"", "probability": 0 } },
+			{ "type": "Invert", "children": [ { "type": "Probability", "params": { "p": 0.0 } } ] }
+		] },
+		{ "type": "Repeat", "params": { "count": 2 }, "children": [
+			{ "type": "DoorAction", "id": 42, "params": { "name": "Close door", "probability": 100 } }
+		] }
+	]
+})";
+
+const char* const XML = R"(<?xml version="1.0"?>
+<!-- the same tree -->
+<Sequence id="10">
+	<DoorAction name="Walk to door" probability="100"/>
+	<Select>
+		<DoorAction name="Open &quot;door&quot;" probability="0"/>
+		<Invert><Probability p="0.0"/></Invert>
+	</Select>
+	<Repeat count="2">
+		<DoorAction id="42" name="Close door" probability="100"/>
+	</Repeat>
+</Sequence>
+)";
+
+void check(const std::unique_ptr<LoadedTree>& loaded) {
+	assert(loaded && loaded->size() == 8);
+	assert(loaded->id(0) == 10 && loaded->id(7) == 42);
+	DoorAction* open = dynamic_cast<DoorAction*>(loaded->node(3));
+	assert(open && open->name == "Open \"door\"" && open->probabilityOfSuccess == 0);
+
+	BT tree;
+	tree.setRootChild(loaded->root());
+	assert(tree.tick() == BT::Status::SUCCESS);
+	assert(static_cast<DoorAction*>(loaded->node(7))->runs == 2);
+}
+
+void testErrors(const NodeRegistry& registry) {
+	std::string error;
+	assert(!TextTree::loadJson("{ \"type\": \"Teleport\" }", registry, &error));
+	assert(error == "line 1: unknown node type Teleport");
+	assert(!TextTree::loadJson("{ \"children\": [], \"type\": \"Sequence\" }", registry, &error));
+	assert(!TextTree::loadJson("{ \"type\": \"Invert\", \"children\": [\n{ \"type\": \"Select\" },\n{ \"type\": \"Select\" } ] }",
+							   registry, &error));
+	assert(error.find("line 3:") == 0);
+	assert(!TextTree::loadJson("{ \"type\": \"Sequence\" } trailing", registry, &error));
+	assert(!TextTree::loadXml("<Sequence><Select></Sequence>", registry, &error));
+	assert(!TextTree::loadXml("<Sequence>text</Sequence>", registry, &error));
+	assert(!TextTree::loadXml("<Probability p=0.5/>", registry, &error));
+
+	// Ids are unique, from 0 on: a reload hands each node the state of the one of the same id.
+	assert(TextTree::loadJson("{ \"type\": \"Sequence\", \"id\": 0 }", registry, &error));
+	assert(!TextTree::loadJson("{ \"type\": \"Sequence\", \"id\": -1 }", registry, &error));
+	assert(error == "line 1: \"id\" must be an integer from 0 to 4294967295");
+	assert(!TextTree::loadJson("{ \"type\": \"Sequence\", \"id\": 4294967296 }", registry, &error));
+	assert(!TextTree::loadJson("{ \"type\": \"Sequence\", \"id\": 1, \"children\": [ { \"type\": \"Select\", \"id\": 1 } ] }",
+							   registry, &error));
+	assert(error == "line 1: duplicate node id 1");
+	assert(!TextTree::loadXml("<Sequence id=\"2\"><Select id=\"2\"/></Sequence>", registry, &error));
+	assert(error == "line 1: duplicate node id 2");
+
+	// A decorator needs its child before the tree can be ticked.
+	assert(!TextTree::loadJson("{ \"type\": \"Invert\" }", registry, &error));
+	assert(error == "node 0 is a decorator without a child");
+	assert(!TextTree::loadXml("<Sequence><Invert/></Sequence>", registry, &error));
+	assert(error == "node 1 is a decorator without a child");
+
+	// The nesting is bounded, rather than overflowing the stack of the parser.
+	const size_t limit = TextTree::Parser::MAX_DEPTH;
+	std::string json, xml;
+	for (size_t i = 0; i < limit; i++) {
+		json += "{ \"type\": \"Sequence\", \"children\": [";
+		xml += "<Sequence>";
+	}
+	std::string jsonEnd, xmlEnd;
+	for (size_t i = 0; i < limit; i++) {
+		jsonEnd += "] }";
+		xmlEnd += "</Sequence>";
+	}
+	assert(TextTree::loadJson(json + jsonEnd, registry, &error));
+	assert(TextTree::loadXml(xml + xmlEnd, registry, &error));
+	assert(!TextTree::loadJson(json + "{ \"type\": \"Sequence\" }" + jsonEnd, registry, &error));
+	assert(error == "line 1: nodes nested deeper than 1000 levels");
+	assert(!TextTree::loadXml(xml + "<Sequence/>" + xmlEnd, registry, &error));
+	assert(error == "line 1: nodes nested deeper than 1000 levels");
+}
+
+int main()
+{
+	const NodeRegistry registry = makeRegistry();
+	std::string error;
+	check(TextTree::loadJson(JSON, registry, &error));
+	check(TextTree::loadXml(XML, registry, &error));
+	assert(error.empty());
+	testErrors(registry);
+	std::cout << "TextTree tests passed." << std::endl;
+}
@@ -0,0 +1,264 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+
+/*
+* Hierarchical timer wheel.
+* Deadlines are bucketed into LEVELS wheels of SLOTS slots each, every level
+* covering SLOTS times the range of the level below. Scheduling and cancelling
+* are O(1); advancing costs one step per elapsed resolution unit, plus the
+* occasional cascade of a higher level slot into the lower levels.
+* Nothing is ever called back: a fired timer simply becomes expired, and its
+* owner polls expired() on its next run. Thousands of nodes can thus wait
+* without holding a thread each.
+*/
+class TimerWheel
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef uint64_t TimerId;
+
+    static const TimerId INVALID = 0;
+
+    /**
+     * Constructor
+     * @param resolution duration of one wheel step, deadlines are rounded up to it
+     * @param start time point of the wheel origin
+     */
+    explicit TimerWheel(const std::chrono::milliseconds resolution = std::chrono::milliseconds(1),
+                        const Clock::time_point start = Clock::now()) :
+            resolution_(resolution), origin_(start), now_(start.time_since_epoch().count()) {
+        for (auto& level : slots_)
+            for (auto& slot : level)
+                slot = NIL;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * Register a deadline.
+     * @return an id to poll with expired(), never INVALID
+     */
+    TimerId schedule(const Clock::time_point deadline) {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        uint32_t index;
+        if (free_ != NIL) {
+            index = free_;
+            free_ = entries_[index].next;
+        }
+        else {
+            index = static_cast<uint32_t>(entries_.size());
+            entries_.emplace_back();
+        }
+        Entry& e = entries_[index];
+        e.expiry = toTicks(deadline);
+        e.armed = true;
+        insert(index, current_ + 1);    // current_ is already processed
+        ++pending_;
+        return (static_cast<TimerId>(e.generation) << 32) | (index + 1);
+    }
+
+    TimerId scheduleAfter(const Clock::duration delay) {
+        return schedule(now() + delay);
+    }
+
+    /**
+     * @return true if the timer has fired, or was cancelled.
+     * Ids carry a generation count, so a stale id reads as expired.
+     */
+    bool expired(const TimerId id) const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        const Entry* e = find(id);
+        return e == nullptr;
+    }
+
+    // Forget about a timer. Cancelling an expired timer is a no-op.
+    void cancel(const TimerId id) {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        const Entry* e = find(id);
+        if (e == nullptr) return;
+        const uint32_t index = static_cast<uint32_t>(e - entries_.data());
+        unlink(index);
+        release(index);
+    }
+
+    /**
+     * Move the wheel forward, expiring every timer whose deadline is <= now.
+     * Time never goes backward: an earlier time point is ignored.
+     * @return the number of timers that fired
+     */
+    size_t advance(const Clock::time_point now) {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        if (now <= this->now()) return 0;
+        now_.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        const uint64_t target = elapsedTicks(now);
+        if (pending_ == 0) {
+            // Nothing to expire: jump straight to the target.
+            current_ = target;
+            return 0;
+        }
+        size_t fired = 0;
+        while (current_ < target && pending_ > 0) {
+            ++current_;
+            // Cascade from the lowest level up, each level only when the one
+            // below it has wrapped around.
+            for (size_t level = 1; level < LEVELS; ++level) {
+                if (slotIndex(current_, level - 1) != 0) break;
+                cascade(level, slotIndex(current_, level));
+            }
+            uint32_t& head = slots_[0][slotIndex(current_, 0)];
+            while (head != NIL) {
+                const uint32_t index = head;
+                unlink(index);
+                release(index);
+                ++fired;
+            }
+        }
+        if (pending_ == 0)
+            current_ = target;
+        return fired;
+    }
+
+    /**
+     * Time point of the last advance(), i.e. the wheel's notion of now.
+     * The clock is sampled once per advance: reading it is a lock free load.
+     */
+    Clock::time_point now() const {
+        return Clock::time_point(Clock::duration(now_.load(std::memory_order_relaxed)));
+    }
+
+    size_t pending() const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        return pending_;
+    }
+
+    /**
+     * Time point at which the next timer may fire, for a caller to sleep until then.
+     * Exact within the range of the lowest level, a lower bound beyond.
+     * @return Clock::time_point::max() if no timer is pending
+     */
+    Clock::time_point nextDeadline() const {
+        std::lock_guard<std::mutex> mlock(mutex_);
+        if (pending_ == 0) return Clock::time_point::max();
+        uint64_t next = UINT64_MAX;
+        for (size_t level = 0; level < LEVELS; ++level) {
+            // Timers of a level fire, or cascade down, once the wheel enters their slot.
+            const size_t shift = SLOT_BITS * level;
+            for (uint64_t i = 1; i <= SLOTS; ++i) {
+                const uint64_t start = ((current_ >> shift) + i) << shift;
+                if (start >= next) break;
+                if (slots_[level][slotIndex(start, level)] != NIL) {
+                    next = start;
+                    break;
+                }
+            }
+        }
+        if (next == UINT64_MAX) return Clock::time_point::max();
+        return origin_ + Clock::duration(resolution_) * static_cast<Clock::rep>(next);
+    }
+
+    Clock::duration resolution() const { return resolution_; }
+
+private:
+    static const size_t LEVELS = 4;
+    static const size_t SLOT_BITS = 6;
+    static const size_t SLOTS = size_t(1) << SLOT_BITS;
+    static const uint64_t RANGE = uint64_t(1) << (SLOT_BITS * LEVELS);
+    static const uint32_t NIL = UINT32_MAX;
+
+    struct Entry {
+        uint64_t expiry = 0;        // in ticks since origin_
+        uint32_t prev = NIL;
+        uint32_t next = NIL;        // also links the free list
+        uint32_t generation = 0;
+        uint16_t level = 0;
+        uint16_t slot = 0;
+        bool armed = false;
+    };
+
+    static size_t slotIndex(const uint64_t tick, const size_t level) {
+        return static_cast<size_t>(tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    }
+
+    uint64_t elapsedTicks(const Clock::time_point t) const {
+        if (t <= origin_) return 0;
+        return static_cast<uint64_t>((t - origin_) / resolution_);
+    }
+
+    // Round up, so a timer never fires before its deadline.
+    uint64_t toTicks(const Clock::time_point t) const {
+        if (t <= origin_) return 0;
+        const auto elapsed = t - origin_;
+        uint64_t ticks = static_cast<uint64_t>(elapsed / resolution_);
+        if (elapsed % resolution_ != Clock::duration::zero()) ++ticks;
+        return ticks;
+    }
+
+    const Entry* find(const TimerId id) const {
+        const uint64_t index = (id & 0xFFFFFFFFu);
+        if (index == 0 || index > entries_.size()) return nullptr;
+        const Entry& e = entries_[index - 1];
+        if (!e.armed || e.generation != static_cast<uint32_t>(id >> 32)) return nullptr;
+        return &e;
+    }
+
+    // Link an entry into the slot matching its expiry, firing no earlier than earliest.
+    void insert(const uint32_t index, const uint64_t earliest) {
+        Entry& e = entries_[index];
+        uint64_t expiry = e.expiry < earliest ? earliest : e.expiry;
+        if (expiry - current_ >= RANGE) expiry = current_ + RANGE - 1;  // cascaded again later
+        size_t level = 0;
+        while (level + 1 < LEVELS && expiry - current_ >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+            ++level;
+        const size_t slot = slotIndex(expiry, level);
+        e.level = static_cast<uint16_t>(level);
+        e.slot = static_cast<uint16_t>(slot);
+        e.prev = NIL;
+        e.next = slots_[level][slot];
+        if (e.next != NIL) entries_[e.next].prev = index;
+        slots_[level][slot] = index;
+    }
+
+    void unlink(const uint32_t index) {
+        Entry& e = entries_[index];
+        if (e.prev != NIL) entries_[e.prev].next = e.next;
+        else slots_[e.level][e.slot] = e.next;
+        if (e.next != NIL) entries_[e.next].prev = e.prev;
+        e.prev = e.next = NIL;
+    }
+
+    void release(const uint32_t index) {
+        Entry& e = entries_[index];
+        e.armed = false;
+        ++e.generation;
+        e.next = free_;
+        free_ = index;
+        --pending_;
+    }
+
+    void cascade(const size_t level, const size_t slot) {
+        uint32_t index = slots_[level][slot];
+        slots_[level][slot] = NIL;
+        while (index != NIL) {
+            const uint32_t next = entries_[index].next;
+            insert(index, current_);
+            index = next;
+        }
+    }
+
+    const Clock::duration resolution_;
+    const Clock::time_point origin_;
+    std::atomic<Clock::rep> now_;
+    uint64_t current_ = 0;          // ticks since origin_ already processed
+    size_t pending_ = 0;
+    std::vector<Entry> entries_;
+    uint32_t free_ = NIL;
+    uint32_t slots_[LEVELS][SLOTS];
+    mutable std::mutex mutex_{};
+};
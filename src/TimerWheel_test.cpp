@@ -0,0 +1,126 @@
+//
+// Timer wheel and the time based nodes built on it.
+//
+
+#include <iostream>
+#include <cassert>
+#include "TimerWheel.h"
+#include "BehaviourTree.h"
+
+typedef BehaviourTree BT;
+using std::chrono::milliseconds;
+
+class Counter : public BT::Node {
+public:
+	int runs = 0;
+	BT::Status run(BT::TickContext&) override { ++runs; return BT::Status::SUCCESS; }
+};
+
+void testWheel() {
+	const TimerWheel::Clock::time_point t0;
+	TimerWheel wheel(milliseconds(1), t0);
+
+	TimerWheel::TimerId soon = wheel.schedule(t0 + milliseconds(3));
+	TimerWheel::TimerId later = wheel.schedule(t0 + milliseconds(100));      // level 1
+	TimerWheel::TimerId much = wheel.schedule(t0 + milliseconds(300000));    // level 3
+	TimerWheel::TimerId dropped = wheel.schedule(t0 + milliseconds(50));
+	assert(soon != TimerWheel::INVALID);
+	assert(wheel.pending() == 4);
+
+	wheel.cancel(dropped);
+	assert(wheel.expired(dropped));
+	assert(wheel.pending() == 3);
+
+	assert(wheel.nextDeadline() == t0 + milliseconds(3));
+	assert(wheel.advance(t0 + milliseconds(2)) == 0);
+	assert(!wheel.expired(soon));
+	assert(wheel.advance(t0 + milliseconds(3)) == 1);
+	assert(wheel.expired(soon));
+	// Beyond the lowest level, the time the timer's slot is cascaded down.
+	assert(wheel.nextDeadline() == t0 + milliseconds(64));
+	wheel.advance(t0 + milliseconds(64));
+	assert(wheel.nextDeadline() == t0 + milliseconds(100));
+
+	wheel.advance(t0 + milliseconds(99));
+	assert(!wheel.expired(later));
+	wheel.advance(t0 + milliseconds(100));
+	assert(wheel.expired(later));
+
+	wheel.advance(t0 + milliseconds(299999));
+	assert(!wheel.expired(much));
+	wheel.advance(t0 + milliseconds(300000));
+	assert(wheel.expired(much));
+	assert(wheel.pending() == 0);
+	assert(wheel.nextDeadline() == TimerWheel::Clock::time_point::max());
+
+	// Overdue deadlines fire on the next advance; recycled slots don't revive stale ids.
+	TimerWheel::TimerId overdue = wheel.schedule(t0);
+	assert(!wheel.expired(overdue));
+	wheel.advance(t0 + milliseconds(300001));
+	assert(wheel.expired(overdue));
+	TimerWheel::TimerId recycled = wheel.schedule(t0 + milliseconds(400000));
+	assert(recycled != overdue);
+	assert(wheel.expired(overdue) && !wheel.expired(recycled));
+}
+
+void testNodes() {
+	BT tree;
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+
+	BT::Sleep sleep(milliseconds(5));
+	tree.setRootChild(&sleep);
+	assert(tree.tick(t0) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(4)) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(5)) == BT::Status::SUCCESS);
+	assert(tree.getContext().now == t0 + milliseconds(5));
+	assert(tree.getContext().tickId == 3);
+
+	Counter counter;
+	BT::Wait wait(milliseconds(5));
+	wait.setChild(&counter);
+	tree.setRootChild(&wait);
+	assert(tree.tick(t0 + milliseconds(10)) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(12)) == BT::Status::RUNNING);
+	assert(counter.runs == 0);
+	assert(tree.tick(t0 + milliseconds(15)) == BT::Status::SUCCESS);
+	assert(counter.runs == 1);
+
+	counter.runs = 0;
+	BT::Cooldown cooldown(milliseconds(5));
+	cooldown.setChild(&counter);
+	tree.setRootChild(&cooldown);
+	assert(tree.tick(t0 + milliseconds(20)) == BT::Status::SUCCESS);
+	assert(tree.tick(t0 + milliseconds(21)) == BT::Status::FAILURE);
+	assert(counter.runs == 1);
+	assert(tree.tick(t0 + milliseconds(25)) == BT::Status::SUCCESS);
+	assert(counter.runs == 2);
+
+	// Timeout halts a child that is still RUNNING past the deadline.
+	BT::Sleep longSleep(milliseconds(10));
+	BT::Timeout timeout(milliseconds(5));
+	timeout.setChild(&longSleep);
+	tree.setRootChild(&timeout);
+	assert(tree.tick(t0 + milliseconds(30)) == BT::Status::RUNNING);
+	assert(tree.getTimers().pending() == 1);
+	assert(tree.tick(t0 + milliseconds(34)) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(35)) == BT::Status::FAILURE);
+	assert(tree.getTimers().pending() == 0);
+	BT::Timeout lenient(milliseconds(20));
+	lenient.setChild(&longSleep);
+	tree.setRootChild(&lenient);
+	assert(tree.tick(t0 + milliseconds(40)) == BT::Status::RUNNING);
+	assert(tree.tick(t0 + milliseconds(50)) == BT::Status::SUCCESS);
+
+	// The blocking run() keeps ticking until the sleep is over, sleeping between the passes.
+	tree.setRootChild(&sleep);
+	const uint64_t before = tree.getContext().tickId;
+	assert(tree.run() == BT::Status::SUCCESS);
+	assert(tree.getContext().tickId - before <= 50);
+}
+
+int main()
+{
+	testWheel();
+	testNodes();
+	std::cout << "TimerWheel tests passed." << std::endl;
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <cctype>
+#include <cstdint>
+#include "TextTree.h"
+
+
+/*
+* Ahead of time compiler of tree descriptions (see TextTree) into C++ headers.
+* A tree becomes a class template Tree<Leaves> in a namespace of its own, with
+* one inline function per node: the Sequence, Select, Invert, Succeed and Fail
+* nodes are written out as nested calls and branches over the Status, which
+* the C++ compiler is free to inline into one function. Like those of a
+* FlatTree, these composites keep no memory between ticks.
+* The other built-in nodes are members of the class, ticked as usual, their
+* children being generated functions. Any other type is a user leaf, called
+* by name on the Leaves object given to the tree:
+*   BehaviourTree::Status DoorAction(BehaviourTree::TickContext& ctx, const NodeParams& params);
+* with the parameters of the node in the description.
+* bt_compile is the command line tool, bt_compile_tree() its CMake function.
+*/
+namespace TreeCompiler {
+
+    // A node as described: its type and parameters, and its children if it may have any.
+    struct Description {
+        std::string type;
+        ParamList params;
+    };
+
+    class DescribedComposite : public BehaviourTree::CompositeNode, public Description {
+        virtual BehaviourTree::Status run(BehaviourTree::TickContext&) override { return BehaviourTree::Status::ERROR; }
+    };
+    class DescribedDecorator : public BehaviourTree::DecoratorNode, public Description {
+        virtual BehaviourTree::Status run(BehaviourTree::TickContext&) override { return BehaviourTree::Status::ERROR; }
+    };
+    class DescribedLeaf : public BehaviourTree::Node, public Description {
+        virtual BehaviourTree::Status run(BehaviourTree::TickContext&) override { return BehaviourTree::Status::ERROR; }
+    };
+
+    inline void copy(const NodeParams& from, ParamList& to) {
+        for (size_t i = 0; i < from.size(); i++) {
+            switch (from.kind(i)) {
+            case NodeParams::Kind::INTEGER: to.set(from.name(i), from.integer(i)); break;
+            case NodeParams::Kind::REAL: to.set(from.name(i), from.real(i)); break;
+            case NodeParams::Kind::STRING: to.set(from.name(i), from.string(i)); break;
+            }
+        }
+    }
+
+    template <typename D>
+    BehaviourTree::Node* describe(Arena& arena, const std::string& type, const NodeParams& params) {
+        D* node = arena.create<D>();
+        node->type = type;
+        copy(params, node->params);
+        return node;
+    }
+
+    // A registry reading any description without building its nodes: the built-in
+    // composites and decorators take children, every other type is a leaf.
+    inline NodeRegistry describing() {
+        NodeRegistry r;
+        for (const char* type : { "Sequence", "Select" }) {
+            const std::string name = type;
+            r.add(name, [name](Arena& a, const NodeParams& p) { return describe<DescribedComposite>(a, name, p); });
+        }
+        for (const char* type : { "Invert", "Succeed", "Fail", "Repeat", "RepeatUntil", "Async", "Wait", "Cooldown", "Timeout", "Memo", "Incremental" }) {
+            const std::string name = type;
+            r.add(name, [name](Arena& a, const NodeParams& p) { return describe<DescribedDecorator>(a, name, p); });
+        }
+        r.setFallback(&describe<DescribedLeaf>);
+        return r;
+    }
+
+    class Generator {
+    public:
+        Generator(const LoadedTree& tree, std::string* error) : tree_(tree), error_(error) {}
+
+        // @param name the namespace of the generated code
+        bool generate(const std::string& name, const std::string& source, std::ostream& out) {
+            if (!identifier(name)) return fail("\"" + name + "\" is not a valid namespace name");
+            if (tree_.size() == 0) return fail("the tree is empty");
+            for (size_t i = 0; i < tree_.size(); i++) index_[tree_.node(i)] = i;
+            for (size_t i = 0; i < tree_.size(); i++)
+                if (!node(i)) return false;
+            out << "// Generated by bt_compile from " << source << ": do not edit.\n"
+                << "#pragma once\n"
+                << "#include <chrono>\n"
+                << "#include \"BehaviourTree.h\"\n"
+                << "#include \"NodeRegistry.h\"\n"
+                << "#include \"FlatTree.h\"\n\n"
+                << "namespace " << name << " {\n\n"
+                << "template <typename Leaves>\n"
+                << "class Tree {\n"
+                << "public:\n"
+                << "\ttypedef BehaviourTree BT;\n\n"
+                << "\texplicit Tree(Leaves& l) : leaves(l) {\n" << constructor_.str() << "\t}\n"
+                << "\tTree(const Tree&) = delete;\n"
+                << "\tTree& operator=(const Tree&) = delete;\n\n"
+                << "\t// Run a single pass, for the agent of a context.\n"
+                << "\tBT::Status tick(BT::TickContext& ctx) { return node0(ctx); }\n"
+                << "\t// A single pass after sampling the clock, like BehaviourTree::tick(root, ctx, now).\n"
+                << "\tBT::Status tick(BT::TickContext& ctx, const TimerWheel::Clock::time_point now) {\n"
+                << "\t\tctx.now = now;\n"
+                << "\t\t++ctx.tickId;\n"
+                << "\t\tctx.scratch.reset();\n"
+                << "\t\tctx.timers.advance(now);\n"
+                << "\t\treturn node0(ctx);\n"
+                << "\t}\n\n"
+                << "private:\n"
+                << functions_.str() << "\n"
+                << "\tLeaves& leaves;\n"
+                << members_.str()
+                << "};\n\n"
+                << "}\n";
+            return true;
+        }
+
+    private:
+        // The function of a node, and what it needs as members.
+        bool node(const size_t i) {
+            const BehaviourTree::Node* n = tree_.node(i);
+            const std::string fn = "node" + std::to_string(i);
+            if (const DescribedComposite* c = dynamic_cast<const DescribedComposite*>(n)) {
+                functions_ << "\t// " << c->type << "\n\tinline BT::Status " << fn << "(BT::TickContext& ctx) {\n";
+                const size_t count = c->getChildren().size();
+                if (c->type == "Sequence") {
+                    if (count == 0) functions_ << "\t\treturn BT::Status::SUCCESS;\n";
+                    if (count > 1) functions_ << "\t\tBT::Status s;\n";
+                    for (size_t k = 0; k < count; k++) {
+                        const std::string call = "node" + std::to_string(child(c->getChildren()[k])) + "(ctx)";
+                        if (k + 1 < count) functions_ << "\t\tif ((s = " << call << ") != BT::Status::SUCCESS) return s;\n";
+                        else functions_ << "\t\treturn " << call << ";\n";
+                    }
+                }
+                else {
+                    if (count > 0) functions_ << "\t\tbool running = false;\n\t\tBT::Status s;\n";
+                    for (Node* k : c->getChildren()) {
+                        functions_ << "\t\ts = node" << child(k) << "(ctx);\n"
+                                   << "\t\tif (s == BT::Status::SUCCESS || s == BT::Status::ERROR) return s;\n"
+                                   << "\t\trunning = running || s == BT::Status::RUNNING;\n";
+                    }
+                    functions_ << (count > 0 ? "\t\treturn running ? BT::Status::RUNNING : BT::Status::FAILURE;\n"
+                                             : "\t\treturn BT::Status::FAILURE;\n");
+                }
+                functions_ << "\t}\n";
+                return true;
+            }
+            if (const DescribedDecorator* d = dynamic_cast<const DescribedDecorator*>(n)) {
+                if (!d->hasChild()) return fail("node " + std::to_string(tree_.id(i)) + ": " + d->type + " without a child");
+                const size_t c = child(d->getChild());
+                functions_ << "\t// " << d->type << "\n\tinline BT::Status " << fn << "(BT::TickContext& ctx) {\n";
+                if (d->type == "Invert" || d->type == "Succeed" || d->type == "Fail") {
+                    functions_ << "\t\tconst BT::Status s = node" << c << "(ctx);\n"
+                               << "\t\tif (s != BT::Status::SUCCESS && s != BT::Status::FAILURE) return s;\n";
+                    if (d->type == "Invert") functions_ << "\t\treturn s == BT::Status::SUCCESS ? BT::Status::FAILURE : BT::Status::SUCCESS;\n";
+                    else functions_ << "\t\treturn BT::Status::" << (d->type == "Succeed" ? "SUCCESS" : "FAILURE") << ";\n";
+                    functions_ << "\t}\n";
+                    return true;
+                }
+                // A built-in node, whose child is the generated function called through a FunctionNode.
+                functions_ << "\t\treturn builtin" << i << ".tick(ctx);\n\t}\n"
+                           << "\tstatic BT::Status call" << c << "(void* self, BT::TickContext& ctx) {\n"
+                           << "\t\treturn static_cast<Tree*>(self)->node" << c << "(ctx);\n\t}\n";
+                members_ << "\t" << builtin(*d, "builtin" + std::to_string(i)) << ";\n"
+                         << "\tFunctionNode adapter" << c << "{ &Tree::call" << c << ", this };\n";
+                constructor_ << "\t\tbuiltin" << i << ".setChild(&adapter" << c << ");\n";
+                return true;
+            }
+            const DescribedLeaf& leaf = static_cast<const DescribedLeaf&>(*n);
+            functions_ << "\t// " << leaf.type << "\n\tinline BT::Status " << fn << "(BT::TickContext& ctx) {\n";
+            if (leaf.type == "Sleep" || leaf.type == "Probability") {
+                functions_ << "\t\treturn builtin" << i << ".tick(ctx);\n\t}\n";
+                members_ << "\t" << builtin(leaf, "builtin" + std::to_string(i)) << ";\n";
+                return true;
+            }
+            if (!identifier(leaf.type)) return fail("node " + std::to_string(tree_.id(i)) + ": \"" + leaf.type + "\" can't name a leaf function");
+            functions_ << "\t\treturn leaves." << leaf.type << "(ctx, params" << i << ");\n\t}\n";
+            members_ << "\tParamList params" << i << ";\n";
+            for (size_t k = 0; k < leaf.params.size(); k++) {
+                constructor_ << "\t\tparams" << i << ".set(" << literal(leaf.params.name(k)) << ", ";
+                switch (leaf.params.kind(k)) {
+                case NodeParams::Kind::INTEGER: constructor_ << "int64_t(" << leaf.params.integer(k) << "LL)"; break;
+                case NodeParams::Kind::REAL: constructor_ << real(leaf.params.real(k)); break;
+                case NodeParams::Kind::STRING: constructor_ << literal(leaf.params.string(k)); break;
+                }
+                constructor_ << ");\n";
+            }
+            return true;
+        }
+
+        // The declaration of a built-in node, with the arguments NodeRegistry::withBuiltins() gives it.
+        static std::string builtin(const Description& d, const std::string& member) {
+            const NodeParams& p = d.params;
+            std::string arguments;
+            if (d.type == "Repeat")
+                arguments = std::to_string(p.getInt("count", -1));
+            else if (d.type == "RepeatUntil")
+                arguments = std::string("\"\", BT::Status::") + BehaviourTree::statusName(p.getStatus("status", BehaviourTree::Status::FAILURE));
+            else if (d.type == "Async")
+                arguments = "std::chrono::microseconds(" + std::to_string(p.getInt("poll_us", 10)) + ")";
+            else if (d.type == "Probability")
+                arguments = real(p.getReal("p", 0.5));
+            else if (d.type == "Memo" || d.type == "Incremental")
+                arguments = "std::vector<Blackboard::Key>{ " + keys(p.getString("watch")) + " }";
+            else
+                arguments = "std::chrono::milliseconds(" + std::to_string(p.getInt("ms", 1)) + ")";
+            return "BT::" + d.type + " " + member + "{ " + arguments + " }";
+        }
+
+        // The keys of a list of variable names, as C++.
+        static std::string keys(const std::string& names) {
+            ParamList p;
+            p.set("watch", names);
+            std::string out;
+            for (const Blackboard::Key k : p.getKeys("watch"))
+                out += (out.empty() ? "" : ", ") + std::string("Blackboard::key(") + literal(Blackboard::name(k)) + ")";
+            return out;
+        }
+
+        size_t child(const BehaviourTree::Node* node) const { return index_.at(node); }
+
+        static bool identifier(const std::string& s) {
+            if (s.empty() || std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+            for (const char c : s)
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+            return true;
+        }
+
+        static std::string literal(const std::string& s) {
+            std::ostringstream out;
+            out << '"';
+            for (const char c : s) {
+                if (c == '"' || c == '\\') out << '\\' << c;
+                else if (c == '\n') out << "\\n";
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    out << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else out << c;
+            }
+            out << '"';
+            return out.str();
+        }
+
+        static std::string real(const double d) {
+            std::ostringstream out;
+            out << std::setprecision(std::numeric_limits<double>::max_digits10) << d;
+            std::string s = out.str();
+            if (s.find_first_of(".en") == std::string::npos) s += ".0";
+            return s;
+        }
+
+        bool fail(const std::string& message) {
+            return LoadedTree::fail(error_, message);
+        }
+
+        typedef BehaviourTree::Node Node;
+
+        const LoadedTree& tree_;
+        std::string* error_;
+        std::unordered_map<const Node*, size_t> index_;
+        std::ostringstream functions_, members_, constructor_;
+    };
+
+    /**
+     * Generate the C++ header implementing a tree description, JSON or XML.
+     * @param name the namespace of the generated code
+     * @return false if the description can't be read or compiled, described in error if given
+     */
+    inline bool compile(const std::string& text, const std::string& name, std::ostream& out,
+                        std::string* error = nullptr, const std::string& source = "a description") {
+        const NodeRegistry registry = describing();
+        const size_t first = text.find_first_not_of(" \t\r\n");
+        const std::unique_ptr<LoadedTree> tree = first != std::string::npos && text[first] == '<' ?
+            TextTree::loadXml(text, registry, error) : TextTree::loadJson(text, registry, error);
+        if (!tree) return false;
+        return Generator(*tree, error).generate(name, source, out);
+    }
+}
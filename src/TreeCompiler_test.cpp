@@ -0,0 +1,115 @@
+//
+// Trees compiled ahead of time into C++ (doors.h is generated from doors.json by bt_compile).
+//
+
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TreeCompiler.h"
+#include "doors.h"
+
+typedef BehaviourTree BT;
+
+struct Door {
+	int doorNumber;
+};
+
+// The leaves of doors.json, called by name by the generated tree.
+struct Leaves {
+	std::vector<Door> building;
+	ConcurrentStack<Door*> doors;
+	const Blackboard::Key currentDoor = Blackboard::key("currentDoor");
+	const Blackboard::Key usedDoor = Blackboard::key("usedDoor");
+	std::vector<std::string> log;
+
+	explicit Leaves(const int numDoors) {
+		for (int i = numDoors; i > 0; i--) building.push_back(Door{ i });
+	}
+
+	BT::Status GetDoorStack(BT::TickContext&, const NodeParams&) {
+		for (Door& door : building) doors.push(&door);
+		return BT::Status::SUCCESS;
+	}
+	BT::Status PopDoor(BT::TickContext& ctx, const NodeParams&) {
+		Door* door;
+		if (!doors.try_pop_for(door, std::chrono::milliseconds(0)))
+			return BT::Status::FAILURE;
+		ctx.blackboard.set(currentDoor, door);
+		log.push_back("door " + std::to_string(door->doorNumber));
+		return BT::Status::SUCCESS;
+	}
+	BT::Status DoorAction(BT::TickContext& ctx, const NodeParams& params) {
+		const bool success = ctx.rng.below(100) < static_cast<uint32_t>(params.getInt("probability"));
+		log.push_back(params.getString("name") + (success ? " succeeded" : " failed"));
+		return success ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+	BT::Status SetUsedDoor(BT::TickContext& ctx, const NodeParams&) {
+		ctx.blackboard.set(usedDoor, ctx.blackboard.get<Door*>(currentDoor));
+		return BT::Status::SUCCESS;
+	}
+	BT::Status UsedDoorIsNull(BT::TickContext& ctx, const NodeParams&) {
+		return ctx.blackboard.get<Door*>(usedDoor) == nullptr ? BT::Status::SUCCESS : BT::Status::FAILURE;
+	}
+};
+
+// doors.json written by hand.
+BT::Status reference(Leaves& l, BT::TickContext& ctx) {
+	ParamList none;
+	const auto action = [&](const char* name, const int probability) {
+		ParamList p;
+		p.set("name", name).set("probability", probability);
+		return l.DoorAction(ctx, p) == BT::Status::SUCCESS;
+	};
+	l.GetDoorStack(ctx, none);
+	while (l.PopDoor(ctx, none) == BT::Status::SUCCESS) {
+		if (action("Walk to door", 99) &&
+			(action("Open door", 12) || action("Unlock door", 25) || action("Smash door", 60)) &&
+			action("Walk through door", 85)) {
+			action("Close door", 100);
+			l.SetUsedDoor(ctx, none);
+			break;
+		}
+	}
+	return l.UsedDoorIsNull(ctx, none) == BT::Status::SUCCESS ? BT::Status::FAILURE : BT::Status::SUCCESS;
+}
+
+void testDoors() {
+	for (uint64_t seed = 0; seed < 50; seed++) {
+		BT tree, expectedTree;
+		Leaves leaves(5), expectedLeaves(5);
+		tree.getContext().rng.seed(seed);
+		expectedTree.getContext().rng.seed(seed);
+		doors::Tree<Leaves> compiled(leaves);
+		const BT::Status s = compiled.tick(tree.getContext(), tree.getTimers().now());
+		assert(s == reference(expectedLeaves, expectedTree.getContext()));
+		assert(leaves.log == expectedLeaves.log && !leaves.log.empty());
+	}
+}
+
+void testErrors() {
+	std::ostringstream out;
+	std::string error;
+	assert(!TreeCompiler::compile(R"({ "type": "Invert" })", "t", out, &error));
+	assert(error.find("without a child") != std::string::npos);
+	assert(!TreeCompiler::compile(R"({ "type": "Door-Action" })", "t", out, &error));
+	assert(error.find("Door-Action") != std::string::npos);
+	assert(!TreeCompiler::compile(R"({ "type": "Sequence", "children": [ )", "t", out, &error));
+	assert(error.find("line 1") == 0);
+	assert(!TreeCompiler::compile(R"({ "type": "Sleep" })", "3d", out, &error));
+
+	// XML as well, with built-in leaves and strings to escape.
+	std::ostringstream xml;
+	assert(TreeCompiler::compile(R"(<Select><Sleep ms="5"/><Say text="a &quot;b&quot;\c"/></Select>)", "t", xml, &error));
+	const std::string header = xml.str();
+	assert(header.find("BT::Sleep builtin1{ std::chrono::milliseconds(5) };") != std::string::npos);
+	assert(header.find(R"(params2.set("text", "a \"b\"\\c");)") != std::string::npos);
+}
+
+int main()
+{
+	testDoors();
+	testErrors();
+	std::cout << "TreeCompiler tests passed." << std::endl;
+}
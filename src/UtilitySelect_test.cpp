@@ -0,0 +1,100 @@
+//
+// Utility based selection and its SIMD argmax.
+//
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "BehaviourTree.h"
+#include "Random.h"
+
+typedef BehaviourTree BT;
+using std::chrono::milliseconds;
+
+class Counter : public BT::Node {
+public:
+	explicit Counter(BT::Status result = BT::Status::SUCCESS) : result(result) {}
+	int runs = 0;
+	BT::Status result;
+	BT::Status run(BT::TickContext&) override { ++runs; return result; }
+};
+
+void testArgmax() {
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float inf = std::numeric_limits<float>::infinity();
+	const float few[] = { 1, 3, 2 };
+	assert(Simd::argmax(few, 3) == 1);
+	const float ties[] = { 0, 5, 1, 2, 5, 5, 0, 0, 5 };
+	assert(Simd::argmax(ties, 9) == 1);
+	const float nans[] = { nan, nan, nan, nan, nan };
+	assert(Simd::argmax(nans, 5) == 5);
+	const float mixed[] = { nan, -inf, nan, nan, nan, -inf };
+	assert(Simd::argmax(mixed, 6) == 1);
+	assert(Simd::argmax(nullptr, 0) == 0);
+
+	// Against a plain loop, with NaNs here and there.
+	Random rng(7);
+	for (int n = 1; n < 100; n++) {
+		std::vector<float> v(n);
+		for (float& f : v) f = rng.below(10) == 0 ? nan : static_cast<float>(rng.below(50));
+		size_t expected = n;
+		for (int i = 0; i < n; i++)
+			if (!std::isnan(v[i]) && (expected == static_cast<size_t>(n) || v[i] > v[expected])) expected = i;
+		assert(Simd::argmax(v.data(), n) == expected);
+	}
+}
+
+void testSelect() {
+	BT tree;
+	Blackboard& bb = tree.getBlackboard();
+	const Blackboard::Key flee = Blackboard::key("fleeUtility");
+	Counter attack, run, idle(BT::Status::FAILURE);
+	BT::UtilitySelect select;
+	select.addChild(&attack, [](BT::TickContext& ctx) {
+		return ctx.blackboard.get<float>(Blackboard::key("health"), 0.0f);
+	});
+	select.addChild(&run, flee);
+	select.addChild(&idle);		// scores 0
+	tree.setRootChild(&select);
+
+	bb.set(Blackboard::key("health"), 0.8f);
+	bb.set(flee, 0.2f);
+	assert(tree.tick() == BT::Status::SUCCESS && attack.runs == 1);
+	bb.set(flee, 0.9f);
+	assert(tree.tick() == BT::Status::SUCCESS && run.runs == 1);
+	bb.set(Blackboard::key("health"), -1.0f);
+	bb.set(flee, std::numeric_limits<float>::quiet_NaN());	// ruled out
+	assert(tree.tick() == BT::Status::FAILURE && idle.runs == 1);
+}
+
+void testRunningChild() {
+	BT tree;
+	Blackboard& bb = tree.getBlackboard();
+	const Blackboard::Key a = Blackboard::key("a"), b = Blackboard::key("b");
+	BT::Sleep sleep(milliseconds(5));
+	Counter other;
+	BT::UtilitySelect select;
+	select.addChild(&sleep, a);
+	select.addChild(&other, b);
+	tree.setRootChild(&select);
+	const TimerWheel::Clock::time_point t0 = tree.getTimers().now();
+
+	bb.set(a, 1.0f);
+	bb.set(b, 0.0f);
+	assert(tree.tick(t0) == BT::Status::RUNNING);
+	// Kept on the RUNNING child although the other one now scores higher.
+	bb.set(b, 2.0f);
+	assert(tree.tick(t0 + milliseconds(1)) == BT::Status::RUNNING && other.runs == 0);
+	assert(tree.tick(t0 + milliseconds(5)) == BT::Status::SUCCESS);
+	assert(tree.tick(t0 + milliseconds(6)) == BT::Status::SUCCESS && other.runs == 1);
+}
+
+int main()
+{
+	testArgmax();
+	testSelect();
+	testRunningChild();
+	std::cout << "UtilitySelect tests passed." << std::endl;
+}
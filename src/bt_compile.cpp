@@ -0,0 +1,56 @@
+// bt_compile: compile a tree description, JSON or XML, into a C++ header (see TreeCompiler.h).
+//
+//   bt_compile <tree.json> <output.h> [namespace]
+//
+// The namespace defaults to the description's file name without extension.
+// The output is only written when it changes, so as not to trigger rebuilds.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "TreeCompiler.h"
+
+int main(int argc, char* argv[]) {
+	if (argc < 3 || argc > 4) {
+		std::cerr << "usage: bt_compile <tree.json> <output.h> [namespace]" << std::endl;
+		return 2;
+	}
+	const std::string input = argv[1], output = argv[2];
+	std::string name;
+	if (argc == 4) {
+		name = argv[3];
+	}
+	else {
+		const size_t slash = input.find_last_of("/\\");
+		name = input.substr(slash == std::string::npos ? 0 : slash + 1);
+		name = name.substr(0, name.find('.'));
+	}
+
+	std::ifstream file(input, std::ios::binary);
+	std::stringstream text;
+	text << file.rdbuf();
+	if (!file) {
+		std::cerr << "bt_compile: can't open " << input << std::endl;
+		return 1;
+	}
+	std::ostringstream header;
+	std::string error;
+	if (!TreeCompiler::compile(text.str(), name, header, &error, input.substr(input.find_last_of("/\\") + 1))) {
+		std::cerr << input << ": " << error << std::endl;
+		return 1;
+	}
+
+	std::ifstream previous(output, std::ios::binary);
+	std::stringstream existing;
+	existing << previous.rdbuf();
+	if (previous && existing.str() == header.str())
+		return 0;
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	out << header.str();
+	if (!out) {
+		std::cerr << "bt_compile: can't write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}